@@ -0,0 +1,539 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+  * @brief Benchmarks for the module's hot paths.
+  *
+  * Prints one JSON object per line:
+  *
+  * {"benchmark":"mountinfo.parse","n":5000,"iterations":100,"ns_per_op":123.4}
+  *
+  * The memory benchmarks report bytes instead:
+  *
+  * {"benchmark":"agent.memory","n":2000,"heap_per_agent":2345,"estimate_per_agent":2100,"strings":6000}
+  *
+  * With '-q device' only the quota reader is checked (and timed) against a
+  * filesystem with quotas; see quota.sh, which builds one.
+  *
+  * With '-s sysfs' only the queue advisor is checked (and timed) against a
+  * fake sysfs tree (src/testprogram/sysfs).
+  *
+  */
+
+ #include <config.h>
+ #include <udjat/mountinfo.h>
+ #include <udjat/filesystem.h>
+ #include <udjat/request.h>
+ #include <udjat/atom.h>
+ #include <agent.h>
+ #include <container.h>
+ #include <openmetrics.h>
+ #include <udjat/procio.h>
+ #include <udjat/quota.h>
+ #include <udjat/queue.h>
+ #include <udjat/backend.h>
+ #include <pugixml.hpp>
+ #include <sys/sysmacros.h>
+ #include <iostream>
+ #include <sstream>
+ #include <chrono>
+ #include <vector>
+ #include <string>
+ #include <functional>
+ #include <algorithm>
+ #include <stdexcept>
+ #include <cstdlib>
+ #include <cstring>
+ #include <unistd.h>
+ #include <fstream>
+ #include <sys/stat.h>
+ #include <malloc.h>
+
+ using namespace std;
+
+ static struct {
+	size_t devices = 500;
+	size_t mounts = 5000;
+	size_t children = 2000;
+	size_t iterations = 100;
+	size_t processes = 10000;
+	const char *path = "/dev/shm";
+	const char *quota = nullptr;	///< @brief Device with quotas, for the quota check.
+	const char *sysfs = nullptr;	///< @brief Fake sysfs tree, for the queue check.
+ } options;
+
+ /// @brief Run 'call' for 'iterations' times, print the average time per operation.
+ static void measure(const char *name, size_t n, size_t iterations, const std::function<void()> &call) {
+
+	auto start = std::chrono::steady_clock::now();
+
+	for(size_t ix = 0; ix < iterations; ix++) {
+		call();
+	}
+
+	double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	cout	<< "{\"benchmark\":\"" << name << "\""
+			<< ",\"n\":" << n
+			<< ",\"iterations\":" << iterations
+			<< ",\"ns_per_op\":" << (ns / ((double) iterations))
+			<< "}" << endl;
+
+ }
+
+ /// @brief Build a synthetic mountinfo with 'devices' block backed mounts out of 'mounts' entries.
+ static string mountinfo(size_t devices, size_t mounts) {
+
+	std::stringstream text;
+
+	for(size_t ix = 0; ix < mounts; ix++) {
+
+		if(ix < devices) {
+			text	<< (ix+100) << " 1 8:" << ix << " / /bench/disk" << ix
+					<< " rw,relatime shared:1 - ext4 /dev/bench" << ix << " rw" << "\n";
+		} else {
+			text	<< (ix+100) << " 1 0:" << ix << " / /run/bench/overlay" << ix
+					<< " rw,relatime - overlay overlay rw,lowerdir=/a,upperdir=/b" << "\n";
+		}
+
+	}
+
+	return text.str();
+
+ }
+
+ static void discovery() {
+
+	string text = mountinfo(options.devices,options.mounts);
+
+	Udjat::MountInfo mounts;
+
+	measure("mountinfo.parse",options.mounts,options.iterations,[&text,&mounts](){
+		mounts.parse(text.c_str());
+	});
+
+	measure("mountinfo.join",options.devices,options.iterations,[&mounts](){
+		size_t found = 0;
+		for(size_t ix = 0; ix < options.devices; ix++) {
+			if(mounts.find(makedev(8,ix))) {
+				found++;
+			}
+		}
+		if(found != options.devices) {
+			throw runtime_error("Unexpected join result");
+		}
+	});
+
+	// Container construction from synthetic device and mount tables, replayed
+	// through Udjat::Backend::Replay (the host's own disks aren't involved).
+	static const struct {
+		size_t devices;
+		size_t mounts;
+	} sizes[] = {
+		{ 10, 100 },
+		{ 100, 1000 },
+		{ 0, 0 },		// options.devices, options.mounts
+	};
+
+	string filename{options.path};
+	filename += "/benchmark.trace";
+
+	pugi::xml_node node;
+	for(const auto &size : sizes) {
+
+		size_t devices = (size.devices ? size.devices : options.devices);
+		size_t mounts = (size.mounts ? size.mounts : options.mounts);
+
+		{
+			ofstream trace{filename};
+			if(!trace) {
+				throw runtime_error(string{"Can't write "} + filename);
+			}
+
+			for(size_t ix = 0; ix < devices; ix++) {
+				trace	<< "0\tdevice\t/dev/bench" << ix << "\t\text4\t"
+						<< (unsigned long long) makedev(8,ix) << "\n";
+			}
+
+			// Trace fields escape newlines.
+			string table = mountinfo(devices,mounts);
+			trace << "0\tmountinfo\t";
+			for(char chr : table) {
+				if(chr == '\n') {
+					trace << "\\n";
+				} else {
+					trace << chr;
+				}
+			}
+			trace << "\n";
+		}
+
+		Udjat::Backend::set(make_shared<Udjat::Backend::Replay>(filename.c_str()));
+		unlink(filename.c_str());
+
+		string name{"container.construct."};
+		name += std::to_string(devices);
+		name += "x";
+		name += std::to_string(mounts);
+
+		measure(name.c_str(),devices,std::max(options.iterations / 10, (size_t) 1),[&node,devices](){
+			Container container{node};
+			size_t agents = 0;
+			for(auto child : container) {
+				if(dynamic_cast<::Agent *>(child.get())) {
+					agents++;
+				}
+			}
+			if(agents != devices) {
+				throw runtime_error("Unexpected number of disk agents");
+			}
+		});
+
+	}
+
+	Udjat::Backend::set(make_shared<Udjat::Backend>());
+
+ }
+
+ static void refresh() {
+
+	::Agent inline_agent{options.path,"bench"};
+	inline_agent.setTimeout(0);
+
+	measure("agent.refresh.inline",1,options.iterations * 100,[&inline_agent](){
+		inline_agent.refresh();
+	});
+
+	::Agent agent{options.path,"bench"};
+	measure("agent.refresh.pool",1,options.iterations * 100,[&agent](){
+		agent.refresh();
+	});
+
+ }
+
+ static void lookup() {
+
+	static const char *mountpoints[] = {
+		"/", "/home", "/boot/efi", "/srv/www", "/var", "/data/volume"
+	};
+
+	measure("agent.construct",(sizeof(mountpoints)/sizeof(mountpoints[0])),options.iterations * 100,[](){
+		for(size_t ix = 0; ix < (sizeof(mountpoints)/sizeof(mountpoints[0])); ix++) {
+			::Agent agent{mountpoints[ix]};
+		}
+	});
+
+ }
+
+ static void serialize() {
+
+	pugi::xml_node node;
+	Container container{node};
+	OpenMetrics metrics;
+
+	for(size_t ix = 0; ix < options.children; ix++) {
+		string name{"bench"};
+		name += std::to_string(ix);
+		auto agent = make_shared<::Agent>(::Agent::Metadata::build(options.path,name.c_str(),"/dev/bench","tmpfs"));
+		agent->setTimeout(0);
+		agent->refresh();
+		container.push_back(agent);
+		metrics.insert(agent);
+	}
+
+	Udjat::Request request;
+
+	measure("container.get.cold",options.children,options.iterations,[&container,&request](){
+		Udjat::Response response;
+		container.invalidate();
+		container.get(request,response);
+	});
+
+	measure("container.get.cached",options.children,options.iterations,[&container,&request](){
+		Udjat::Response response;
+		container.get(request,response);
+	});
+
+	std::string text;
+	measure("openmetrics.render",options.children,options.iterations,[&metrics,&text](){
+		metrics.render(text);
+	});
+
+ }
+
+ /// @brief Heap in use (bytes).
+ static size_t allocated() {
+	return mallinfo2().uordblks;
+ }
+
+ /// @brief Memory of 'children' disk agents, then the strings left after retiring them.
+ static void memory() {
+
+	size_t strings = Udjat::Atom::count();
+	size_t heap = allocated();
+	size_t estimate = 0;
+
+	{
+		std::vector<std::shared_ptr<::Agent>> agents;
+		agents.reserve(options.children);
+
+		for(size_t ix = 0; ix < options.children; ix++) {
+			string mp{"/bench/disk"};
+			mp += std::to_string(ix);
+			string device{"/dev/bench"};
+			device += std::to_string(ix);
+
+			auto agent = make_shared<::Agent>(::Agent::Metadata::build(mp.c_str(),"",device.c_str(),"ext4"));
+			agent->start();
+			estimate += agent->memory();
+			agents.push_back(agent);
+		}
+
+		heap = allocated() - heap - (agents.capacity() * sizeof(agents[0]));
+
+		cout	<< "{\"benchmark\":\"agent.memory\""
+				<< ",\"n\":" << options.children
+				<< ",\"heap_per_agent\":" << (heap / options.children)
+				<< ",\"estimate_per_agent\":" << (estimate / options.children)
+				<< ",\"strings\":" << (Udjat::Atom::count() - strings)
+				<< "}" << endl;
+	}
+
+	// Retired agents must not leave their interned strings behind.
+	size_t left = Udjat::Atom::count() - strings;
+
+	cout	<< "{\"benchmark\":\"agent.retire\""
+			<< ",\"n\":" << options.children
+			<< ",\"strings_left\":" << left
+			<< "}" << endl;
+
+	if(left) {
+		throw runtime_error("Interned strings not released");
+	}
+
+ }
+
+ /// @brief Sample a synthetic /proc with 'processes' entries, then the real one.
+ static void processes() {
+
+	string root{options.path};
+	root += "/udjat-benchmark-proc";
+	mkdir(root.c_str(),0700);
+
+	for(size_t ix = 0; ix < options.processes; ix++) {
+		string dir = root + "/" + std::to_string(ix+1);
+		mkdir(dir.c_str(),0700);
+		ofstream io{dir + "/io"};
+		io	<< "rchar: 0\nwchar: 0\nsyscr: 0\nsyscw: 0\n"
+			<< "read_bytes: " << (ix * 4096) << "\n"
+			<< "write_bytes: " << (ix * 8192) << "\n"
+			<< "cancelled_write_bytes: 0\n";
+	}
+
+	{
+		Udjat::ProcessIO io{10,root.c_str()};
+		io.sample();
+		measure("procio.sample",options.processes,options.iterations,[&io](){
+			io.sample();
+		});
+	}
+
+	for(size_t ix = 0; ix < options.processes; ix++) {
+		string dir = root + "/" + std::to_string(ix+1);
+		unlink((dir + "/io").c_str());
+		rmdir(dir.c_str());
+	}
+	rmdir(root.c_str());
+
+	Udjat::ProcessIO io{10};
+	io.sample();
+	measure("procio.sample.proc",io.size(),options.iterations,[&io](){
+		io.sample();
+	});
+
+ }
+
+ /// @brief Read every quota type of options.quota, expect an id above 80% on each.
+ static void quotas() {
+
+	for(auto type : { Udjat::Quota::User, Udjat::Quota::Group, Udjat::Quota::Project }) {
+
+		size_t count = 0;
+		float highest = 0;
+
+		bool enabled = Udjat::Quota::get(options.quota,type,[&count,&highest](const Udjat::Quota::Entry &entry){
+			count++;
+			highest = std::max(highest,entry.percent());
+		});
+
+		cout	<< "{\"benchmark\":\"quota.check\""
+				<< ",\"type\":\"" << Udjat::Quota::name(type) << "\""
+				<< ",\"enabled\":" << (enabled ? "true" : "false")
+				<< ",\"n\":" << count
+				<< ",\"highest\":" << highest
+				<< "}" << endl;
+
+		if(!enabled || highest < 80) {
+			throw runtime_error(string{"No "} + Udjat::Quota::name(type) + " quota above 80% on " + options.quota);
+		}
+
+		measure((string{"quota.get."} + Udjat::Quota::name(type)).c_str(),count,options.iterations,[type](){
+			Udjat::Quota::get(options.quota,type,[](const Udjat::Quota::Entry &){});
+		});
+
+	}
+
+ }
+
+ /// @brief Check the queue advisor against the fake sysfs tree in src/testprogram/sysfs.
+ static void queues() {
+
+	static const struct {
+		unsigned int major;
+		unsigned int minor;
+		const char *disk;
+		const char *type;
+		size_t mismatches;		///< @brief With the default rules.
+	} disks[] = {
+		{   8,	1,	"sda",		"hdd",		1	},	// Partition; bfq, but 128KB read-ahead.
+		{ 259,	0,	"nvme0n1",	"nvme",		2	},	// mq-deadline and max_sectors_kb=128.
+		{ 254,	0,	"dm-0",		"virtual",	0	},	// LVM on sda1, the defaults don't apply.
+	};
+
+	for(const auto &expected : disks) {
+
+		std::string name = Udjat::Queue::name(makedev(expected.major,expected.minor),options.sysfs);
+		if(name != expected.disk) {
+			throw runtime_error(string{"Unexpected disk '"} + name + "' for " + expected.disk);
+		}
+
+		Udjat::Queue queue{name.c_str(),options.sysfs};
+		if(strcmp(queue.getType(),expected.type)) {
+			throw runtime_error(string{"Unexpected type '"} + queue.getType() + "' for " + expected.disk);
+		}
+
+		auto mismatches = queue.check(Udjat::Queue::defaults());
+
+		cout	<< "{\"benchmark\":\"queue.check\""
+				<< ",\"disk\":\"" << name << "\""
+				<< ",\"type\":\"" << queue.getType() << "\""
+				<< ",\"mismatches\":" << mismatches.size()
+				<< "}" << endl;
+
+		if(mismatches.size() != expected.mismatches) {
+			throw runtime_error(string{"Unexpected mismatches on "} + expected.disk);
+		}
+
+	}
+
+	{
+		// Virtual devices are checked through their member disks.
+		auto members = Udjat::Queue::members("dm-0",options.sysfs);
+		if(members.size() != 1 || members[0] != "sda") {
+			throw runtime_error("Unexpected members of dm-0");
+		}
+	}
+
+	{
+		// Numeric rule, read_ahead_kb is 128 in the fixture.
+		Udjat::Queue::Rule rule;
+		rule.device = "sda";
+		rule.attribute = "read_ahead_kb";
+		rule.min = 4096;
+
+		auto mismatches = Udjat::Queue{"sda",options.sysfs}.check({rule});
+		if(mismatches.size() != 1 || mismatches[0].current != "128" || mismatches[0].recommended != "4096") {
+			throw runtime_error("Unexpected read_ahead_kb check on sda");
+		}
+	}
+
+	Udjat::Queue queue{"nvme0n1",options.sysfs};
+	measure("queue.check",1,options.iterations,[&queue](){
+		queue.check(Udjat::Queue::defaults());
+	});
+
+ }
+
+ int main(int argc, char **argv) {
+
+	int opt;
+	while((opt = getopt(argc,argv,"d:m:c:i:n:p:q:s:")) != -1) {
+		switch(opt) {
+		case 'd':
+			options.devices = strtoul(optarg,NULL,10);
+			break;
+		case 'm':
+			options.mounts = strtoul(optarg,NULL,10);
+			break;
+		case 'c':
+			options.children = strtoul(optarg,NULL,10);
+			break;
+		case 'i':
+			options.iterations = strtoul(optarg,NULL,10);
+			break;
+		case 'n':
+			options.processes = strtoul(optarg,NULL,10);
+			break;
+		case 'p':
+			options.path = optarg;
+			break;
+		case 'q':
+			options.quota = optarg;
+			break;
+		case 's':
+			options.sysfs = optarg;
+			break;
+		default:
+			cerr << "Usage: " << argv[0] << " [-d devices] [-m mounts] [-c children] [-i iterations] [-n processes] [-p path] [-q device] [-s sysfs]" << endl;
+			return -1;
+		}
+	}
+
+	if(options.devices > options.mounts) {
+		options.mounts = options.devices;
+	}
+
+	try {
+
+		if(options.quota) {
+			quotas();
+			return 0;
+		}
+
+		if(options.sysfs) {
+			queues();
+			return 0;
+		}
+
+		discovery();
+		refresh();
+		lookup();
+		serialize();
+		memory();
+		processes();
+
+	} catch(const std::exception &e) {
+		cerr << e.what() << endl;
+		return -1;
+	}
+
+	return 0;
+
+ }
@@ -0,0 +1,111 @@
+#!/bin/bash
+#
+# Build a loop-mounted ext4 or XFS image with user, group and project quotas
+# (one id of each above 80%) and check the quota reader against it.
+#
+# Usage: quota.sh [ext4|xfs]
+#
+# Needs root. Exits with 77 (skipped) if the kernel or the tools can't do it.
+#
+
+FS=${1:-ext4}
+BENCHMARK=${BENCHMARK:-.bin/Release/benchmark}
+
+ID=65534		# nobody/nogroup
+PROJECT=4242
+
+skip() {
+	echo "Skipping ${FS} quota test: $*" >&2
+	exit 77
+}
+
+fail() {
+	echo "${FS} quota test failed: $*" >&2
+	exit 1
+}
+
+# Check kernel option, if the kernel config is available.
+kconfig() {
+	if [ -r /proc/config.gz ]; then
+		zgrep -q "^${1}=y" /proc/config.gz
+	elif [ -r /boot/config-$(uname -r) ]; then
+		grep -q "^${1}=y" /boot/config-$(uname -r)
+	fi
+}
+
+[ "$(id -u)" == "0" ] || skip "must run as root"
+
+kconfig CONFIG_QUOTACTL || skip "kernel without CONFIG_QUOTACTL"
+
+case "${FS}" in
+ext4)
+	kconfig CONFIG_QUOTA || skip "kernel without CONFIG_QUOTA"
+	for tool in mkfs.ext4 setquota chattr; do
+		command -v ${tool} > /dev/null || skip "${tool} not found"
+	done
+	;;
+xfs)
+	kconfig CONFIG_XFS_QUOTA || skip "kernel without CONFIG_XFS_QUOTA"
+	for tool in mkfs.xfs xfs_quota; do
+		command -v ${tool} > /dev/null || skip "${tool} not found"
+	done
+	;;
+*)
+	echo "Usage: $0 [ext4|xfs]" >&2
+	exit 2
+	;;
+esac
+
+[ -x "${BENCHMARK}" ] || skip "${BENCHMARK} not found (run 'make Release' first)"
+
+WORKDIR=$(mktemp -d)
+MOUNTPOINT=${WORKDIR}/mnt
+
+cleanup() {
+	mountpoint -q ${MOUNTPOINT} && umount ${MOUNTPOINT}
+	rm -rf ${WORKDIR}
+}
+trap cleanup EXIT
+
+mkdir ${MOUNTPOINT}
+truncate -s 512M ${WORKDIR}/image || fail "can't create image"
+
+case "${FS}" in
+ext4)
+	mkfs.ext4 -q -F -O quota,project -E quotatype=usrquota:grpquota:prjquota ${WORKDIR}/image \
+		|| fail "mkfs.ext4 failed"
+	mount -o loop,usrquota,grpquota,prjquota ${WORKDIR}/image ${MOUNTPOINT} \
+		|| skip "can't mount ext4 image with quotas"
+
+	# Limits in 1K blocks: soft 1000, hard 2000.
+	setquota -u ${ID} 1000 2000 0 0 ${MOUNTPOINT} || fail "setquota -u failed"
+	setquota -g ${ID} 1000 2000 0 0 ${MOUNTPOINT} || fail "setquota -g failed"
+	setquota -P ${PROJECT} 1000 2000 0 0 ${MOUNTPOINT} || fail "setquota -P failed"
+
+	mkdir ${MOUNTPOINT}/project
+	chattr +P -p ${PROJECT} ${MOUNTPOINT}/project || fail "chattr -p failed"
+	;;
+xfs)
+	mkfs.xfs -q -f ${WORKDIR}/image || fail "mkfs.xfs failed"
+	mount -o loop,uquota,gquota,pquota ${WORKDIR}/image ${MOUNTPOINT} \
+		|| skip "can't mount XFS image with quotas"
+
+	xfs_quota -x -c "limit -u bsoft=1000k bhard=2000k ${ID}" ${MOUNTPOINT} || fail "user limit failed"
+	xfs_quota -x -c "limit -g bsoft=1000k bhard=2000k ${ID}" ${MOUNTPOINT} || fail "group limit failed"
+	xfs_quota -x -c "limit -p bsoft=1000k bhard=2000k ${PROJECT}" ${MOUNTPOINT} || fail "project limit failed"
+
+	mkdir ${MOUNTPOINT}/project
+	xfs_quota -x -c "project -s -p ${MOUNTPOINT}/project ${PROJECT}" ${MOUNTPOINT} > /dev/null \
+		|| fail "project setup failed"
+	;;
+esac
+
+# 900K charged to the user, the group and the project: 90% of the soft limits.
+dd if=/dev/zero of=${MOUNTPOINT}/project/data bs=1K count=900 status=none || fail "can't write data"
+chown ${ID}:${ID} ${MOUNTPOINT}/project/data || fail "chown failed"
+sync
+
+DEVICE=$(findmnt -n -o SOURCE ${MOUNTPOINT})
+
+LD_LIBRARY_PATH=$(dirname ${BENCHMARK}) ${BENCHMARK} -q ${DEVICE} -i 10 || fail "quota check failed"
+
@@ -21,19 +21,171 @@
 
  #include <udjat/defs.h>
  #include <udjat/agent.h>
+ #include <udjat/filesystem.h>
+ #include <udjat/activity.h>
+ #include <udjat/atom.h>
+ #include <udjat/canary.h>
+ #include <udjat/history.h>
+ #include <udjat/instrumentation.h>
  #include <pugixml.hpp>
+ #include <atomic>
+ #include <ctime>
+ #include <memory>
+ #include <mutex>
+ #include <vector>
 
  class UDJAT_API Agent : public Udjat::Agent<float> {
+ public:
+
+	/// @brief Adaptive refresh interval (in seconds), disabled if max is zero.
+	struct Interval {
+		unsigned short min = 0;
+		unsigned short max = 0;
+
+		Interval() = default;
+
+		/// @brief Get interval from 'min-update-timer' and 'max-update-timer' attributes.
+		Interval(const pugi::xml_node &node);
+
+	};
+
+	/// @brief Write/fsync canary settings, disabled if the directory is empty.
+	struct Canary : public Udjat::Canary::Options {
+		float regression = 4;			///< @brief p99 over the baseline raising the 'slow' state.
+		float floor = 1;				///< @brief Latencies (ms) never considered a regression.
+		unsigned short timeout = 30;	///< @brief Seconds for a probe to be considered stalled.
+
+		Canary() = default;
+
+		/// @brief Get settings from the 'canary' (directory, relative to the mount point) and 'canary-*' attributes.
+		Canary(const pugi::xml_node &node);
+
+	};
+
+	/// @brief Immutable disk description, shared with the exporters.
+	/// @details Interned, so thousands of mounts share the repeated strings
+	/// (types, name prefixes) and everything is released with the last agent.
+	struct Metadata {
+		Udjat::Atom mount_point;
+		Udjat::Atom name;			///< @brief Agent name.
+		Udjat::Atom device;			///< @brief Block device name.
+		Udjat::Atom type;			///< @brief Filesystem type.
+		Udjat::Atom label;			///< @brief Filesystem label.
+		dev_t dev = 0;				///< @brief Block device (st_rdev), 0 if unknown.
+
+		/// @brief Build description, the agent name from the label or the mount point.
+		static std::shared_ptr<const Metadata> build(const char *mount_point, const char *label = "", const char *device = "", const char *type = "", dev_t dev = 0);
+	};
+
  private:
 
-	/// @brief Device name.
-	const char *mount_point;
+	/// @brief Disk description.
+	std::shared_ptr<const Metadata> disk;
+
+	/// @brief Expanded state texts, released with the agent.
+	std::vector<Udjat::Atom> texts;
+
+	/// @brief Filesystem handle, kept open while the agent is alive.
+	std::unique_ptr<Udjat::FileSystem> filesystem;
+
+	/// @brief Time limit (in ms) for each filesystem sample.
+	unsigned int timeout = 5000;
+
+	/// @brief State for mount points not answering in time (hung NFS/CIFS servers).
+	std::shared_ptr<Udjat::Abstract::State> unresponsive;
+
+	/// @brief Last filesystem sample, shared with the child agents.
+	Udjat::FileSystem::Stats stats;
+
+	/// @brief Usage (%) of the last sample.
+	float used = 0;
+
+	/// @brief Guards 'stats' and 'used', read by the exporters off the refresh thread.
+	mutable std::mutex guard;
+
+	/// @brief Bytes available to unprivileged users.
+	class Available;
+	std::shared_ptr<Available> available;
+
+	/// @brief Inode usage.
+	class Inodes;
+	std::shared_ptr<Inodes> inodes;
+
+	/// @brief Adaptive refresh interval.
+	Interval interval;
+
+	/// @brief Write activity on the filesystem, empty when polling on the timer.
+	std::unique_ptr<Udjat::Activity> activity;
+
+	/// @brief Event-driven refresh.
+	struct {
+		unsigned short window = 0;				///< @brief Minimum seconds between refreshes, 0 to disable.
+		std::atomic<bool> pending{false};		///< @brief Refresh already requested.
+		time_t sampled = 0;						///< @brief Time of the last sample.
+	} watch;
+
+	/// @brief Write activity detected, request a refresh (at most one per window).
+	void written() noexcept;
+
+	/// @brief Usage history.
+	Udjat::History<64> history;
+
+	/// @brief Write/fsync latency from the canary (empty if disabled).
+	class Latency;
+	std::shared_ptr<Latency> latency;
+
+	/// @brief Usage growth (%/hour) and time to full (hours).
+	class Growth;
+	class Forecast;
+	std::shared_ptr<Growth> growth;
+	std::shared_ptr<Forecast> forecast;
+
+	/// @brief Last exported values, to detect changes.
+	struct {
+		const Udjat::Abstract::State *state = nullptr;
+		long used = -1;		///< @brief Usage in 1/100 %.
+		long rate = 0;		///< @brief Growth in 1/100 %/hour.
+		long ttf = -1;		///< @brief Time to full in minutes.
+	} exported;
+
+	/// @brief Check exported values, increment revision if changed.
+	void changed() noexcept;
+
+ public:
+	/// @brief Revision of the exported data, shared by the disk agents of a container.
+	typedef std::atomic<unsigned int> Revision;
+
+ private:
+	/// @brief Revision to increment when the exported values change (empty if not exported).
+	std::shared_ptr<Revision> revision;
+
+#ifdef HAVE_INSTRUMENTATION
+	/// @brief Refresh latency and error counters.
+	Udjat::Instrumentation::Refresh instrumentation;
+#endif // HAVE_INSTRUMENTATION
+
+	/// @brief Get filesystem sample, update values and states.
+	bool sample();
+
+	/// @brief State boundaries (for the adaptive refresh interval).
+	std::vector<float> boundaries;
 
 	void setup();
 
+ protected:
+
+	/// @brief Get state from value, 'unresponsive' while the mount point is hung.
+	std::shared_ptr<Udjat::Abstract::State> stateFromValue() const override;
+
+ private:
+
+	/// @brief Update refresh interval from the usage rate and the distance to the next state.
+	void reschedule();
+
  public:
  	typedef Udjat::Agent<float> super;
 
+	Agent(std::shared_ptr<const Metadata> metadata);
 	Agent(const char * mount_point, const char *name = "");
 	Agent(const char * mount_point, const char *name, const pugi::xml_node &node);
 
@@ -42,9 +194,61 @@
 	/// @brief Get device status, update internal state.
 	bool refresh() override;
 
+	/// @brief Export agent (memory and instrumentation) info.
+	void get(const Udjat::Request &request, Udjat::Response &response) override;
+
+	/// @brief Set the revision to increment on changes.
+	/// @details Incremented only when a value (at the exported precision) or a state changes.
+	void setRevision(std::shared_ptr<Revision> revision) noexcept;
+
+	/// @brief Enable adaptive refresh interval.
+	void setInterval(const Interval &interval) noexcept;
+
+	/// @brief Refresh on write activity (fanotify) instead of polling.
+	/// @param window Minimum seconds between refreshes, 0 to poll on the timer.
+	void setWatch(unsigned short window) noexcept;
+
+	/// @brief Probe write/fsync latency with a canary file.
+	/// @param canary The canary settings, ignored if the directory is empty.
+	void setCanary(const Canary &canary);
+
+	/// @brief Set time limit for each filesystem sample.
+	/// @param ms Time limit in milliseconds, 0 to wait forever.
+	void setTimeout(unsigned int ms) noexcept;
+
 	/// @brief Get mount point.
 	inline const char * getMountPoint() const noexcept {
-		return mount_point;
+		return disk->mount_point.c_str();
+	}
+
+	/// @brief Get disk description.
+	inline const Metadata & metadata() const noexcept {
+		return *disk;
+	}
+
+	/// @brief Estimate memory used by the agent (children, states and texts included).
+	/// @details Shared strings are counted in full by every agent holding them.
+	size_t memory() const noexcept;
+
+	/// @brief Last filesystem sample with its usage.
+	struct Snapshot {
+		Udjat::FileSystem::Stats stats;
+		float used;		///< @brief Usage in %.
+	};
+
+	/// @brief Get a consistent copy of the last filesystem sample (safe from any thread).
+	Snapshot getSnapshot() const;
+
+	/// @brief Get usage fill rate.
+	/// @return Usage growth in %/second (from the history regression).
+	inline double rate() const noexcept {
+		return history.rate();
+	}
+
+	/// @brief Estimate time to full.
+	/// @return Seconds to reach 100% or negative if usage isn't growing.
+	inline double ttf() const noexcept {
+		return history.eta(100);
 	}
 
 	/// @brief Get value as string.
@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/agent.h>
+ #include <udjat/iostat.h>
+ #include <udjat/mountinfo.h>
+ #include <pugixml.hpp>
+ #include <memory>
+ #include <mutex>
+ #include <string>
+ #include <unordered_map>
+
+ /// @brief Storage throughput of the cgroups in a subtree (cgroup v2 io.stat).
+ /// @details One child agent for each cgroup, created and removed from inotify
+ /// events on the cgroup directories; the per-device figures are mapped to the
+ /// mount points of each disk.
+ class UDJAT_API CGroups : public Udjat::Abstract::Agent {
+ public:
+
+	/// @brief Throughput of a single cgroup.
+	class Group;
+
+ private:
+
+	/// @brief Subtree root (absolute path in the cgroup filesystem).
+	std::string root;
+
+	/// @brief Levels below the root to watch (1 for the direct children only).
+	unsigned short depth = 1;
+
+	/// @brief Seconds between io.stat samples.
+	unsigned short interval = 10;
+
+	/// @brief inotify handle and watched directories (watch descriptor to relative path).
+	int inotify = -1;
+	std::unordered_map<int,std::string> watches;
+
+	/// @brief Guards 'devices' and the child list (changed by the inotify handler).
+	mutable std::mutex guard;
+
+	/// @brief Mount points of each disk.
+	std::unordered_map<dev_t,std::string> devices;
+
+	/// @brief Add cgroup (and its descendants up to 'depth').
+	void scan(const std::string &relative, unsigned short level);
+
+	/// @brief Remove the agents of a cgroup and its descendants.
+	void remove(const std::string &relative);
+
+	/// @brief Process inotify events.
+	void changed();
+
+ public:
+	/// @param subtree The cgroup subtree (relative to /sys/fs/cgroup or absolute).
+	/// @param node Configuration ('cgroups-depth' and 'cgroups-timer' attributes).
+	CGroups(const char *subtree, const pugi::xml_node &node);
+	virtual ~CGroups();
+
+	void start() override;
+
+	/// @brief Update the disk to mount point mapping.
+	void set(const Udjat::MountInfo &mounts);
+
+	/// @brief Get the mount points of a disk (comma separated), empty if not mounted.
+	std::string mountpoints(dev_t disk) const;
+
+	/// @brief Export the throughput of every cgroup.
+	void report(Udjat::Value &value);
+
+ };
@@ -0,0 +1,179 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/agent.h>
+ #include <udjat/mountinfo.h>
+ #include <udjat/instrumentation.h>
+ #include <udjat/endpoint.h>
+ #include <pugixml.hpp>
+ #include <memory>
+ #include <string>
+ #include <set>
+ #include <vector>
+ #include <mutex>
+ #include <ctime>
+ #include <agent.h>
+ #include <openmetrics.h>
+ #include <processes.h>
+ #include <cgroups.h>
+ #include <writeback.h>
+ #include <queues.h>
+
+ /// @brief Container with all disks
+ class UDJAT_API Container : public Udjat::Abstract::Agent {
+ private:
+
+	/// @brief Handle for /proc/self/mountinfo, polled for POLLPRI on mount table changes.
+	int mountinfo = -1;
+
+	/// @brief Last loaded mount table.
+	Udjat::MountInfo mounts;
+
+	/// @brief Filesystem types to ignore (from the ignore-[type] attributes).
+	std::set<std::string> ignored;
+
+	/// @brief Is the container started?
+	bool started = false;
+
+	/// @brief Adaptive refresh interval for the disk agents.
+	::Agent::Interval interval;
+
+	/// @brief Time limit (in ms) for each filesystem sample.
+	unsigned int timeout = 5000;
+
+	/// @brief Refresh the disk agents on write activity, minimum seconds between refreshes (0 to poll).
+	unsigned short watch = 0;
+
+	/// @brief Write/fsync canary for every disk (disabled if the directory is empty).
+	::Agent::Canary canary;
+
+	/// @brief Create I/O agents (from /proc/diskstats) for every disk.
+	bool iostats = false;
+
+	/// @brief Track the N largest and fastest growing files of every disk (0 to disable).
+	unsigned int topfiles = 0;
+
+	/// @brief Changed files remembered per disk for the growth rate.
+	unsigned int tracked = 0;
+
+#ifdef HAVE_INSTRUMENTATION
+	/// @brief Startup discovery phases (in us).
+	struct {
+		uint64_t discovery = 0;		///< @brief Block device enumeration.
+		uint64_t mountinfo = 0;		///< @brief Mount table load.
+		uint64_t join = 0;			///< @brief Device to mount point join.
+		uint64_t agents = 0;		///< @brief Agent creation.
+	} timings;
+#endif // HAVE_INSTRUMENTATION
+
+	/// @brief Processes with the highest I/O rates (empty if disabled).
+	std::shared_ptr<ProcessAgent> processes;
+
+	/// @brief Per-cgroup throughput (empty if disabled).
+	std::shared_ptr<CGroups> cgroups;
+
+	/// @brief Dirty pages and writeback (empty if disabled).
+	std::shared_ptr<WritebackAgent> writeback;
+
+	/// @brief Block queue configuration advisor (empty if disabled).
+	std::shared_ptr<QueueAgent> queues;
+
+	/// @brief OpenMetrics exposition of the disk agents (empty if disabled).
+	std::shared_ptr<OpenMetrics> metrics;
+
+	/// @brief Revision of the exported data, shared with the disk agents.
+	std::shared_ptr<::Agent::Revision> revision = std::make_shared<::Agent::Revision>(1);
+
+	/// @brief Guards the child list: reload() changes it on the main loop, rebuild() walks it on request.
+	std::mutex tree;
+
+	/// @brief Prebuilt export of the disk agents.
+	/// @details Rebuilt only when the revision changes, reused by every request.
+	struct Snapshot {
+
+		std::mutex guard;
+
+		/// @brief Revision of the exported data.
+		unsigned int revision = 0;
+
+		/// @brief When the exported data last changed (Last-Modified of the response).
+		time_t modified = 0;
+
+		/// @brief Estimated memory of the disk agents (see ::Agent::memory()).
+		size_t memory = 0;
+
+		struct Item {
+			std::string name;
+			std::string summary;
+			std::string icon;
+			std::string state;
+			std::string mp;
+			char level[8];
+			char used[16];
+			float rate;		///< @brief Growth in %/hour.
+			long ttf;		///< @brief Time to full in seconds, -1 if not growing.
+		};
+
+		std::vector<Item> items;
+
+		/// @brief The items serialized as JSON, served as is by the endpoint.
+		std::shared_ptr<const std::string> json;
+
+		/// @brief ETag of the serialized items (the quoted revision).
+		std::string etag;
+
+	} snapshot;
+
+	/// @brief HTTP endpoint for the raw exports (empty if disabled).
+	/// @details Declared last: it's stopped before the members its handlers use.
+	std::unique_ptr<Udjat::Endpoint> endpoint;
+
+	/// @brief Rebuild snapshot from the disk agents.
+	void rebuild();
+
+	/// @brief Check for ignore-[type] attribute.
+	bool ignore(const std::string &type) const noexcept;
+
+	/// @brief Find child agent by mount point.
+	std::shared_ptr<::Agent> find(const char *mount_point);
+
+	/// @brief Create agent for mount point (with 'tree' locked once started).
+	/// @param metadata The disk description (with the block device behind the mount point).
+	void insert(std::shared_ptr<const ::Agent::Metadata> metadata);
+
+	/// @brief Mount table has changed, add/remove the changed agents.
+	void reload();
+
+ public:
+	Container(const pugi::xml_node &node);
+	virtual ~Container();
+
+	void start() override;
+
+	/// @brief Export info.
+	void get(const Udjat::Request &request, Udjat::Response &response) override;
+
+	/// @brief Invalidate the exported data.
+	void invalidate() noexcept;
+
+ };
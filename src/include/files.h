@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/agent.h>
+ #include <udjat/activity.h>
+ #include <udjat/ranking.h>
+ #include <sys/types.h>
+ #include <memory>
+ #include <list>
+ #include <mutex>
+ #include <string>
+ #include <unordered_map>
+
+ /// @brief Largest and fastest growing files of a mount point.
+ /// @details Seeded by a parallel walk started on the first refresh (on a background
+ /// thread), then kept current from fanotify events; later refreshes only drop the
+ /// files removed or renamed.
+ class UDJAT_API FilesAgent : public Udjat::Abstract::Agent {
+ private:
+
+	/// @brief Mount point.
+	std::string mount_point;
+
+	/// @brief Worker threads for the seed walk, 0 for the default.
+	unsigned int threads;
+
+	mutable std::mutex guard;
+
+	struct File {
+		std::string path;
+		uint64_t size;
+	};
+
+	/// @brief Largest files (score is the size in bytes).
+	Udjat::Ranking<ino_t,File> largest;
+
+	/// @brief Fastest growing files (score is the growth in bytes/second).
+	Udjat::Ranking<ino_t,File> growing;
+
+	/// @brief Last observed size of the changed files, base for the growth rate.
+	struct Seen {
+		uint64_t size;
+		double time;
+		std::list<ino_t>::iterator position;	///< @brief Position in 'recent'.
+	};
+	std::unordered_map<ino_t,Seen> seen;
+
+	/// @brief Files in 'seen', most recently changed first.
+	std::list<ino_t> recent;
+
+	/// @brief Maximum number of files in 'seen', the least recently changed are dropped.
+	size_t tracked;
+
+	/// @brief Changes on the filesystem, empty if fanotify is not available.
+	std::unique_ptr<Udjat::Activity> activity;
+
+	/// @brief Has the initial walk been started?
+	bool seeded = false;
+
+	/// @brief State of the seed walk, shared with its thread (it may outlive the agent).
+	struct Seed;
+	std::shared_ptr<Seed> seed;
+
+	/// @brief File changed (fanotify event).
+	void changed(int fd);
+
+	/// @brief Drop files removed or renamed since they were ranked.
+	void verify();
+
+ public:
+	/// @param mount_point The mount point to watch.
+	/// @param count Files in each ranking.
+	/// @param tracked Changed files remembered for the growth rate.
+	/// @param threads Worker threads for the seed walk, 0 for the default.
+	FilesAgent(const char *mount_point, size_t count, size_t tracked, unsigned int threads = 0);
+	virtual ~FilesAgent();
+
+	void start() override;
+
+	/// @brief Seed rankings on the first call, verify them later.
+	bool refresh() override;
+
+	/// @brief Export agent and rankings.
+	void get(const Udjat::Request &request, Udjat::Response &response) override;
+
+	/// @brief Export rankings as 'largest' and 'growing' arrays.
+	void report(Udjat::Value &value) const;
+
+ };
@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/agent.h>
+ #include <udjat/diskstats.h>
+ #include <sys/types.h>
+ #include <memory>
+
+ /// @brief Block device I/O throughput and latency (from /proc/diskstats).
+ class UDJAT_API IOAgent : public Udjat::Abstract::Agent {
+ public:
+
+	/// @brief I/O metric (iops, read, write, await, queue, util).
+	class Metric;
+
+ private:
+
+	/// @brief Device major:minor.
+	dev_t device;
+
+	/// @brief Counters from the last refresh.
+	Udjat::DiskStats::Counters previous;
+
+	std::shared_ptr<Metric> metrics[6];
+
+ public:
+	IOAgent(dev_t device, const char *name = "io");
+	virtual ~IOAgent();
+
+	/// @brief Get device counters, update metrics.
+	bool refresh() override;
+
+	/// @brief Get rates from the last refresh.
+	Udjat::DiskStats::Rates rates() const noexcept;
+
+ };
@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <memory>
+ #include <mutex>
+ #include <string>
+ #include <vector>
+ #include <agent.h>
+ #include <io.h>
+
+ /// @brief OpenMetrics (Prometheus) text exposition of the disk agents.
+ /// @details Metric names and label sets are rendered once, when a disk is
+ /// added or removed; a scrape only formats the current values into a
+ /// reused buffer. Served as a raw body from Udjat::Endpoint, the generic
+ /// Udjat::Response tree can only wrap it as a string.
+ class UDJAT_API OpenMetrics {
+ private:
+
+	mutable std::mutex guard;
+
+	struct Disk {
+		std::shared_ptr<::Agent> agent;
+		std::shared_ptr<IOAgent> io;
+		std::string labels;		///< @brief Rendered label set: {mountpoint="...",device="...",...}
+	};
+
+	std::vector<Disk> disks;
+
+	/// @brief Metric family with the sample prefixes of every disk.
+	struct Family {
+		std::string header;						///< @brief '# TYPE' and '# HELP' lines.
+		std::vector<std::string> prefixes;		///< @brief 'name{labels} ', empty if the disk has no value.
+	};
+
+	mutable std::vector<Family> families;
+
+	/// @brief Families must be rebuilt before the next scrape.
+	mutable bool dirty = true;
+
+	/// @brief Values of the current scrape (one row per disk), reused between scrapes.
+	mutable std::vector<double> values;
+
+	/// @brief Output buffer, reused between scrapes.
+	mutable std::string buffer;
+
+	/// @brief Rebuild metric families from the disk list.
+	void rebuild() const;
+
+	/// @brief Format the current values into the output buffer (with the guard locked).
+	void format() const;
+
+ public:
+	OpenMetrics();
+	~OpenMetrics();
+
+	OpenMetrics(const OpenMetrics &) = delete;
+	OpenMetrics & operator=(const OpenMetrics &) = delete;
+
+	/// @brief Add disk to the exposition, labeled from the agent's metadata.
+	/// @param agent The disk agent.
+	/// @param io The I/O agent for the disk (if any).
+	void insert(std::shared_ptr<::Agent> agent, std::shared_ptr<IOAgent> io = std::shared_ptr<IOAgent>());
+
+	/// @brief Remove disk from the exposition.
+	void remove(const ::Agent *agent);
+
+	/// @brief Render the current values.
+	/// @param text Receives the text in OpenMetrics format.
+	void render(std::string &text) const;
+
+ };
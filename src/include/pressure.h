@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/agent.h>
+ #include <udjat/atom.h>
+ #include <pugixml.hpp>
+ #include <atomic>
+ #include <ctime>
+ #include <memory>
+ #include <mutex>
+ #include <string>
+ #include <vector>
+
+ /// @brief I/O pressure stall information (/proc/pressure/io or a cgroup io.pressure).
+ /// @details Registers a kernel PSI trigger and waits for POLLPRI: nothing is
+ /// polled while the system is healthy. After a stall the agent samples the
+ /// averages until no trigger was received for 'hold' seconds.
+ class UDJAT_API PressureAgent : public Udjat::Agent<float> {
+ private:
+
+	/// @brief Pressure file.
+	std::string path;
+
+	/// @brief Serializes the trigger handle, the stall and the timer between the
+	/// main loop (trigger events) and refresh().
+	std::mutex guard;
+
+	/// @brief Trigger handle (-1 if triggers are not available).
+	int fd = -1;
+
+	/// @brief A trigger was registered before, retry it while polling.
+	bool rearm = false;
+
+	/// @brief Trigger line: 'full' (all tasks stalled) instead of 'some'.
+	bool full = false;
+
+	/// @brief Stall threshold and window (in ms).
+	/// @details Without CAP_SYS_RESOURCE the kernel only accepts windows in multiples of 2s.
+	unsigned int threshold = 300;
+	unsigned int window = 2000;
+
+	/// @brief Seconds without triggers before the stall is cleared.
+	unsigned short hold = 30;
+
+	/// @brief Time of the last trigger, 0 if not stalled.
+	/// @details Atomic, stateFromValue() reads it without the guard.
+	std::atomic<time_t> stalled{0};
+
+	/// @brief State while the kernel reports stalls above the threshold.
+	std::shared_ptr<Udjat::Abstract::State> stall;
+
+	/// @brief Expanded state texts.
+	std::vector<Udjat::Atom> texts;
+
+	/// @brief Register the PSI trigger and watch it (with the guard locked).
+	/// @return false if triggers are not available (errno is set).
+	bool arm();
+
+	/// @brief Polling interval (in seconds) without a trigger.
+	inline unsigned short polling() const noexcept {
+		return (unsigned short) ((window + 999) / 1000);
+	}
+
+	/// @brief Read the avg10 value of the trigger line (with the guard locked).
+	float sample() const;
+
+	/// @brief Kernel trigger fired (with the guard locked).
+	void triggered();
+
+	/// @brief Stall detected, activate the 'stalled' state (with the guard locked).
+	void stalling();
+
+ protected:
+
+	/// @brief Get state from value, 'stall' while triggered.
+	std::shared_ptr<Udjat::Abstract::State> stateFromValue() const override;
+
+ public:
+	typedef Udjat::Agent<float> super;
+
+	PressureAgent(const char *name, const pugi::xml_node &node);
+	virtual ~PressureAgent();
+
+	void start() override;
+
+	/// @brief Update the averages, clear the stall when the trigger is quiet.
+	bool refresh() override;
+
+	std::string to_string() const noexcept override;
+
+ };
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/agent.h>
+ #include <udjat/procio.h>
+ #include <mutex>
+
+ /// @brief Processes with the highest storage I/O rates (from /proc/[pid]/io).
+ class UDJAT_API ProcessAgent : public Udjat::Abstract::Agent {
+ private:
+
+	mutable std::mutex guard;
+
+	/// @brief Counters of every process, top talkers of the last refresh.
+	Udjat::ProcessIO io;
+
+ public:
+	/// @param limit Number of processes to export.
+	/// @param interval Seconds between samples.
+	ProcessAgent(size_t limit, unsigned short interval = 10);
+	virtual ~ProcessAgent();
+
+	/// @brief Sample all processes, update the top talkers.
+	bool refresh() override;
+
+	/// @brief Export agent and top talkers.
+	void get(const Udjat::Request &request, Udjat::Response &response) override;
+
+	/// @brief Export the top talkers.
+	void report(Udjat::Value &value) const;
+
+ };
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/agent.h>
+ #include <udjat/queue.h>
+ #include <udjat/mountinfo.h>
+ #include <pugixml.hpp>
+ #include <memory>
+ #include <mutex>
+ #include <string>
+ #include <vector>
+
+ /// @brief Block queue configuration advisor.
+ /// @details One child agent for every disk behind a mount point, checking its
+ /// queue attributes (scheduler, nr_requests, read_ahead_kb, max_sectors_kb,
+ /// write_cache, ...) against a rule set; a mismatch is a warning state with
+ /// the recommended value.
+ class UDJAT_API QueueAgent : public Udjat::Abstract::Agent {
+ public:
+
+	/// @brief Queue settings of a single disk.
+	class Disk;
+
+ private:
+
+	/// @brief sysfs root (a fake tree for testing).
+	std::string sysfs;
+
+	/// @brief Rules from the 'rule' children, the defaults if there's none.
+	std::vector<Udjat::Queue::Rule> rules;
+
+	/// @brief Seconds between checks.
+	unsigned short interval = 3600;
+
+	/// @brief Guards the child list and the mismatches of each disk.
+	mutable std::mutex guard;
+
+	/// @brief Is the agent started? (new disks are started on creation).
+	bool started = false;
+
+ public:
+	/// @param name The agent name.
+	/// @param node Configuration ('sysfs' and 'queues-timer' attributes, 'rule' children).
+	QueueAgent(const char *name, const pugi::xml_node &node);
+	virtual ~QueueAgent();
+
+	void start() override;
+
+	/// @brief Update the disk agents from the mount table.
+	void set(const Udjat::MountInfo &mounts);
+
+	/// @brief Export the settings not matching the rules.
+	void report(Udjat::Value &value);
+
+	void get(const Udjat::Request &request, Udjat::Response &response) override;
+
+ };
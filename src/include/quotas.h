@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/agent.h>
+ #include <udjat/quota.h>
+ #include <udjat/ranking.h>
+ #include <pugixml.hpp>
+ #include <mutex>
+ #include <string>
+ #include <vector>
+
+ /// @brief Users, groups and projects closest to their disk quotas.
+ /// @details The value is the highest usage in % of limit; the top-K ids are exported.
+ class UDJAT_API QuotaAgent : public Udjat::Agent<float> {
+ private:
+
+	/// @brief Mount point.
+	const char *mount_point;
+
+	/// @brief Block device with the filesystem.
+	std::string device;
+
+	/// @brief Quota types to check.
+	std::vector<Udjat::Quota::Type> types;
+
+	/// @brief Number of ids to export.
+	size_t limit;
+
+	mutable std::mutex guard;
+
+	/// @brief Top-K ids by % of limit (key is type << 32 | id).
+	Udjat::Ranking<uint64_t,Udjat::Quota::Entry> top;
+
+	/// @brief Ids checked on the last refresh.
+	size_t ids = 0;
+
+ public:
+	typedef Udjat::Agent<float> super;
+
+	QuotaAgent(const char *mount_point, const char *device, const char *name, const pugi::xml_node &node);
+	virtual ~QuotaAgent();
+
+	void start() override;
+
+	/// @brief Walk the quotas, update the top-K.
+	bool refresh() override;
+
+	/// @brief Export agent and the top-K ids.
+	void get(const Udjat::Request &request, Udjat::Response &response) override;
+
+	std::string to_string() const noexcept override;
+
+ };
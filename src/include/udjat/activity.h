@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <cstddef>
+ #include <functional>
+
+ namespace Udjat {
+
+	/// @brief Write activity on a filesystem (fanotify filesystem mark).
+	/// @details Requires CAP_SYS_ADMIN; the events only wake up the owner, the
+	/// activity is not tracked per file.
+	class UDJAT_API Activity {
+	private:
+		int fd = -1;
+
+	public:
+		/// @brief Watch modify, close-write and delete events on the filesystem containing path.
+		/// @param path Path in the filesystem to watch.
+		/// @param descriptors Report an open descriptor of the changed file (no delete events).
+		/// @exception std::system_error if fanotify is unavailable or not permitted.
+		Activity(const char *path, bool descriptors = false);
+		~Activity();
+
+		Activity(const Activity &) = delete;
+		Activity & operator=(const Activity &) = delete;
+
+		/// @brief Get descriptor to poll (POLLIN when there are pending events).
+		inline int descriptor() const noexcept {
+			return fd;
+		}
+
+		/// @brief Discard pending events.
+		/// @return Number of events discarded.
+		size_t drain() noexcept;
+
+		/// @brief Read pending events.
+		/// @param call Called with the descriptor of the changed file (closed on return).
+		/// @return Number of events read.
+		size_t drain(const std::function<void(int fd)> &call);
+
+	};
+
+ }
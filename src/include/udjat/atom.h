@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <cstddef>
+ #include <string>
+
+ namespace Udjat {
+
+	/// @brief Interned string, released when the last reference goes away.
+	/// @details Like Udjat::Quark, equal strings share a single buffer and c_str()
+	/// stays valid while the atom is alive; unlike it, the buffer is freed with
+	/// the last reference, so names of retired agents don't pile up.
+	class UDJAT_API Atom {
+	private:
+
+		struct Entry;
+		Entry *entry = nullptr;
+
+		/// @brief The interned strings.
+		struct Pool;
+		static Pool & pool();
+
+		void release() noexcept;
+
+	public:
+
+		Atom() = default;
+		Atom(const char *str);
+		Atom(const std::string &str) : Atom(str.c_str()) {
+		}
+
+		Atom(const Atom &src) noexcept;
+		Atom(Atom &&src) noexcept : entry(src.entry) {
+			src.entry = nullptr;
+		}
+
+		Atom & operator=(const Atom &src) noexcept;
+		Atom & operator=(Atom &&src) noexcept;
+
+		~Atom() {
+			release();
+		}
+
+		/// @brief Get the interned string ("" if empty).
+		const char * c_str() const noexcept;
+
+		/// @brief Get string length.
+		size_t size() const noexcept;
+
+		inline bool empty() const noexcept {
+			return size() == 0;
+		}
+
+		/// @brief Equal strings share the entry, compare pointers only.
+		inline bool operator==(const Atom &atom) const noexcept {
+			return entry == atom.entry;
+		}
+
+		inline bool operator!=(const Atom &atom) const noexcept {
+			return entry != atom.entry;
+		}
+
+		/// @brief Get the number of strings in the pool.
+		static size_t count() noexcept;
+
+		/// @brief Get bytes used by the pool (strings and index).
+		static size_t bytes() noexcept;
+
+	};
+
+ }
@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/filesystem.h>
+ #include <udjat/mountinfo.h>
+ #include <udjat/blockdevice.h>
+ #include <functional>
+ #include <memory>
+ #include <string>
+ #include <vector>
+
+ namespace Udjat {
+
+	/// @brief Data source for device discovery and filesystem sampling.
+	/// @details The base class is the live backend (blkid, sysfs, /proc and
+	/// fstatvfs); Recorder captures every call to a trace file and Replay
+	/// feeds a trace back, optionally at accelerated speed.
+	class UDJAT_API Backend {
+	public:
+
+		class Recorder;
+		class Replay;
+
+		Backend() = default;
+		virtual ~Backend();
+
+		/// @brief Get the active backend.
+		static Backend & getInstance();
+
+		/// @brief Replace the active backend.
+		static void set(std::shared_ptr<Backend> backend);
+
+		/// @brief Enumerate block devices.
+		/// @param devices The list of devices.
+		/// @param probe If true use blkid_probe_all instead of sysfs/udev.
+		virtual void discover(std::vector<BlockDevice> &devices, bool probe);
+
+		/// @brief Load the mount table.
+		/// @param mounts The mount table to load.
+		/// @param fd Handle for /proc/self/mountinfo (or -1).
+		virtual void mountinfo(MountInfo &mounts, int fd);
+
+		/// @brief Read /proc/diskstats.
+		/// @param text Buffer for the file contents (reused between calls).
+		virtual void diskstats(std::string &text);
+
+		/// @brief Sample filesystem statistics.
+		/// @param mount_point The mount point.
+		/// @param stats The filesystem statistics.
+		/// @param sample The live sampler (fstatvfs on the persistent handle).
+		/// @return 0 or errno.
+		virtual int stats(const char *mount_point, FileSystem::Stats &stats, const std::function<int(FileSystem::Stats &stats)> &sample);
+
+	};
+
+	/// @brief Live backend recording every result to a trace file.
+	class UDJAT_API Backend::Recorder : public Backend {
+	private:
+		struct Trace;
+		std::unique_ptr<Trace> trace;
+
+	public:
+		Recorder(const char *filename);
+		virtual ~Recorder();
+
+		void discover(std::vector<BlockDevice> &devices, bool probe) override;
+		void mountinfo(MountInfo &mounts, int fd) override;
+		void diskstats(std::string &text) override;
+		int stats(const char *mount_point, FileSystem::Stats &stats, const std::function<int(FileSystem::Stats &stats)> &sample) override;
+
+	};
+
+	/// @brief Backend replaying a trace file.
+	class UDJAT_API Backend::Replay : public Backend {
+	private:
+		struct Trace;
+		std::unique_ptr<Trace> trace;
+
+	public:
+
+		/// @brief Load trace.
+		/// @param filename The trace file (from Backend::Recorder).
+		/// @param speed Replay speed; 0 returns the recorded samples in order, one per call,
+		/// ignoring timestamps and latencies (deterministic stepping).
+		Replay(const char *filename, float speed = 0);
+		virtual ~Replay();
+
+		void discover(std::vector<BlockDevice> &devices, bool probe) override;
+		void mountinfo(MountInfo &mounts, int fd) override;
+		void diskstats(std::string &text) override;
+		int stats(const char *mount_point, FileSystem::Stats &stats, const std::function<int(FileSystem::Stats &stats)> &sample) override;
+
+	};
+
+ }
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <sys/types.h>
+ #include <string>
+ #include <vector>
+
+ namespace Udjat {
+
+	/// @brief Block device with a filesystem.
+	struct UDJAT_API BlockDevice {
+
+		/// @brief Device name (/dev/sda1, /dev/mapper/system-root, ...)
+		std::string devname;
+
+		/// @brief Filesystem label.
+		std::string label;
+
+		/// @brief Filesystem type.
+		std::string type;
+
+		/// @brief Device major:minor (0 if unknown).
+		dev_t dev = 0;
+
+		BlockDevice(const char *d, const std::string &l, const std::string &t, dev_t dv = 0) : devname(d), label(l), type(t), dev(dv) {
+		}
+
+		/// @brief Enumerate block devices from /sys/class/block and the udev database.
+		/// @details Only devices without udev data are probed with blkid, so sleeping
+		/// disks and slow LUNs are not touched when udev already knows them.
+		static void discover(std::vector<BlockDevice> &devices);
+
+		/// @brief Enumerate block devices with blkid_probe_all (reads every superblock).
+		static void probe(std::vector<BlockDevice> &devices);
+
+	};
+
+ }
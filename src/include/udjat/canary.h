@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <sys/types.h>
+ #include <cstddef>
+ #include <cstdint>
+ #include <memory>
+ #include <string>
+
+ namespace Udjat {
+
+	/// @brief Active write/fsync/read latency probe.
+	/// @details Each probe rewrites a small file, fsyncs it and reads it back
+	/// (with O_DIRECT or after dropping it from the page cache) on its own
+	/// thread. Probes are serialized per device, across all canaries, and
+	/// spaced to keep the I/O below the configured rate.
+	class UDJAT_API Canary {
+	public:
+
+		struct Options {
+			std::string directory;			///< @brief Directory for the canary file, empty to disable.
+			size_t size = 4096;				///< @brief Bytes written and read by each probe.
+			unsigned short interval = 60;	///< @brief Seconds between probes.
+			unsigned int rate = 64;			///< @brief Maximum canary I/O per device, in KB/s.
+			bool direct = false;			///< @brief Use O_DIRECT.
+			size_t window = 60;				///< @brief Probes in the latency window.
+		};
+
+		/// @brief Latency percentiles over the window (in us).
+		struct Percentiles {
+			size_t samples = 0;
+			uint32_t p50 = 0;
+			uint32_t p90 = 0;
+			uint32_t p99 = 0;
+		};
+
+	private:
+
+		/// @brief Probe state, shared with the probing thread.
+		struct Context;
+		std::shared_ptr<Context> context;
+
+	public:
+
+		/// @param options Canary settings (the directory must exist).
+		Canary(const Options &options);
+		~Canary();
+
+		Canary(const Canary &) = delete;
+		Canary & operator=(const Canary &) = delete;
+
+		/// @brief Start a probe in background.
+		/// @return false if skipped (a probe is running on the device or the rate limit was reached).
+		bool probe();
+
+		/// @brief Get seconds the running probe has been waiting, 0 if idle.
+		double pending() const noexcept;
+
+		/// @brief Write and fsync latency.
+		Percentiles write() const;
+
+		/// @brief Read back latency.
+		Percentiles read() const;
+
+		/// @brief Probes failed (I/O errors or data mismatch).
+		uint64_t errors() const noexcept;
+
+		/// @brief Probes skipped (device busy or rate limited).
+		uint64_t skipped() const noexcept;
+
+	};
+
+ }
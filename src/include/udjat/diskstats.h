@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <sys/types.h>
+ #include <cstdint>
+ #include <functional>
+
+ namespace Udjat {
+
+	/// @brief Block device I/O counters from /proc/diskstats.
+	/// @details All devices are loaded with a single read, shared by every agent
+	/// refreshing in the same cycle.
+	class UDJAT_API DiskStats {
+	public:
+
+		struct Counters {
+
+			/// @brief Monotonic time of the sample (in seconds).
+			double timestamp = 0;
+
+			uint64_t reads = 0;			///< @brief Reads completed.
+			uint64_t read_sectors = 0;	///< @brief Sectors (512 bytes) read.
+			uint64_t read_ms = 0;		///< @brief Time spent reading (ms).
+			uint64_t writes = 0;		///< @brief Writes completed.
+			uint64_t write_sectors = 0;	///< @brief Sectors (512 bytes) written.
+			uint64_t write_ms = 0;		///< @brief Time spent writing (ms).
+			uint64_t in_flight = 0;		///< @brief I/Os currently in progress.
+			uint64_t io_ms = 0;			///< @brief Time spent doing I/Os (ms).
+			uint64_t weighted_ms = 0;	///< @brief Weighted time spent doing I/Os (ms).
+
+		};
+
+		/// @brief Derived rates between two samples.
+		struct Rates {
+			float iops = 0;				///< @brief I/O operations per second.
+			float read = 0;				///< @brief Bytes read per second.
+			float write = 0;			///< @brief Bytes written per second.
+			float await = 0;			///< @brief Average time per I/O (ms).
+			float queue = 0;			///< @brief Average queue depth.
+			float util = 0;				///< @brief Percent of time the device was busy.
+
+			Rates() = default;
+			Rates(const Counters &previous, const Counters &current);
+
+		};
+
+		/// @brief Get the current counters for a device.
+		/// @param dev The device (major:minor).
+		/// @param counters The device counters.
+		/// @return false if the device is not in /proc/diskstats.
+		static bool get(dev_t dev, Counters &counters);
+
+		/// @brief Parse diskstats contents.
+		/// @param text The contents of /proc/diskstats.
+		/// @param timestamp The sample time.
+		/// @param call Callback for each device.
+		static void parse(const char *text, double timestamp, const std::function<void(dev_t dev, const Counters &counters)> &call);
+
+	};
+
+ }
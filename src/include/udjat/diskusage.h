@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <sys/types.h>
+ #include <sys/stat.h>
+ #include <cstdint>
+ #include <functional>
+ #include <mutex>
+ #include <string>
+ #include <unordered_map>
+ #include <vector>
+
+ namespace Udjat {
+
+	/// @brief Parallel directory size scanner (du -x).
+	/// @details Directories are walked by a pool of threads with work stealing,
+	/// reading entries with getdents64 and sizes with statx. The listing of every
+	/// directory is cached by inode and mtime so the next scan lists only the
+	/// directories changed since then; unchanged directories cost a single statx.
+	/// That statx isn't skipped: a change deep in the tree leaves the mtime of its
+	/// ancestors alone, so no subtree can be trusted as unchanged and a scan with
+	/// nothing changed still costs one statx per directory.
+	/// Files growing in place don't change the directory mtime, a full rescan
+	/// (see DiskUsage::invalidate) picks them up.
+	class UDJAT_API DiskUsage {
+	public:
+
+		/// @brief Totals of a top-level subdirectory.
+		struct Entry {
+			std::string name;
+			uint64_t bytes = 0;		///< @brief Allocated bytes (hard links counted once per link).
+			uint64_t files = 0;		///< @brief Files and directories.
+		};
+
+		/// @brief File visitor for DiskUsage::walk(), called from the worker threads.
+		typedef std::function<void(const std::string &path, const struct statx &st)> Visitor;
+
+		/// @brief Counters of the last scan.
+		struct Counters {
+			uint64_t directories = 0;	///< @brief Directories visited.
+			uint64_t listed = 0;		///< @brief Directories read (not in cache or changed).
+			uint64_t errors = 0;		///< @brief Entries not accessible.
+			double elapsed = 0;			///< @brief Scan time in seconds.
+		};
+
+	private:
+
+		/// @brief Cached directory listing.
+		struct Node {
+			int64_t mtime = 0;					///< @brief Directory mtime (ns).
+			uint64_t bytes = 0;					///< @brief Allocated bytes of the files in the directory.
+			uint64_t files = 0;					///< @brief Files in the directory.
+			std::vector<std::string> subdirs;	///< @brief Subdirectory names.
+			unsigned int generation = 0;		///< @brief Last scan visiting the node.
+		};
+
+		/// @brief Cache shard (by inode), to keep the workers from serializing on a single lock.
+		struct Shard {
+			std::mutex guard;
+			std::unordered_map<ino_t,Node> nodes;
+		};
+
+		static constexpr size_t shards = 64;
+		Shard cache[shards];
+
+		/// @brief Scan number, to drop nodes for removed directories.
+		unsigned int generation = 0;
+
+		/// @brief Worker threads, 0 for the default.
+		unsigned int threads;
+
+		Counters counters;
+
+		struct Walk;
+
+		/// @brief Get the number of worker threads.
+		size_t workers() const noexcept;
+
+	public:
+		DiskUsage(unsigned int threads = 0);
+		~DiskUsage();
+
+		DiskUsage(const DiskUsage &) = delete;
+		DiskUsage & operator=(const DiskUsage &) = delete;
+
+		/// @brief Get the sizes of the top-level subdirectories.
+		/// @param path The directory to scan (subdirectories in other filesystems are skipped).
+		/// @param entries The top-level subdirectories.
+		void scan(const char *path, std::vector<Entry> &entries);
+
+		/// @brief Visit every regular file under path (same filesystem only).
+		/// @details Uses the same worker pool as scan() but bypasses the cache.
+		/// @param path The directory to walk.
+		/// @param visitor Called for each file, concurrently from the workers.
+		void walk(const char *path, const Visitor &visitor);
+
+		/// @brief Drop the cache, the next scan lists every directory.
+		void invalidate() noexcept;
+
+		/// @brief Get counters of the last scan.
+		inline const Counters & stats() const noexcept {
+			return counters;
+		}
+
+	};
+
+ }
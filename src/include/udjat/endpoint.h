@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <functional>
+ #include <memory>
+ #include <mutex>
+ #include <string>
+ #include <thread>
+ #include <unordered_map>
+
+ namespace Udjat {
+
+	/// @brief Minimal HTTP endpoint for bodies the Udjat::Response tree can't carry.
+	/// @details Serves prebuilt text (OpenMetrics exposition, disk snapshot) as raw
+	/// bodies with their own content type; requests are answered one at a time on
+	/// a dedicated thread, each connection is closed after the reply.
+	class UDJAT_API Endpoint {
+	public:
+
+		struct Request {
+			bool head = false;		///< @brief HEAD request, send the headers only.
+			std::string accept;		///< @brief Accept header.
+			std::string etag;		///< @brief If-None-Match header.
+		};
+
+		struct Reply {
+			const char *status = "200 OK";
+			const char *type = "text/plain; charset=utf-8";
+			std::string etag;							///< @brief ETag header (quoted), empty for none.
+			std::shared_ptr<const std::string> body;	///< @brief Sent as is, can be shared with the producer.
+		};
+
+		/// @brief Build the reply for a path, called from the endpoint thread.
+		typedef std::function<void(const Request &request, Reply &reply)> Handler;
+
+	private:
+
+		/// @brief Listening socket.
+		int sock = -1;
+
+		/// @brief Pipe to stop the server thread.
+		int stop[2] = { -1, -1 };
+
+		std::mutex guard;
+		std::unordered_map<std::string,Handler> handlers;
+
+		std::thread server;
+
+		/// @brief Accept and answer requests until stopped.
+		void serve();
+
+		/// @brief Answer a single request.
+		void reply(int client);
+
+	public:
+
+		/// @brief Start listening.
+		/// @param address Address to bind, empty for all.
+		/// @param port TCP port.
+		Endpoint(const char *address, unsigned short port);
+		~Endpoint();
+
+		Endpoint(const Endpoint &) = delete;
+		Endpoint & operator=(const Endpoint &) = delete;
+
+		/// @brief Serve path (without the query string).
+		void insert(const char *path, const Handler &handler);
+
+	};
+
+ }
@@ -20,22 +20,82 @@
  #pragma once
 
  #include <udjat/defs.h>
+ #include <cstdint>
+ #include <memory>
+ #include <system_error>
 
  namespace Udjat {
 
 	/// @brief File system object.
 	class UDJAT_API FileSystem {
+	public:
+
+		struct Stats;
+
+		/// @brief Mount point didn't answer in time.
+		class UDJAT_API Timeout : public std::system_error {
+		public:
+			Timeout(const char *path);
+		};
+
 	private:
 
-		/// @brief Handle for the disk device.
-		int handle;
+		/// @brief Handle and probe state, shared with the sampling threads.
+		struct Context;
+		std::shared_ptr<Context> context;
+
+		/// @brief Time limit for open/fstatvfs (ms), 0 to run them in the caller's thread.
+		unsigned int timeout;
 
 	public:
-		FileSystem(const char *path);
+
+		/// @brief Filesystem statistics from a single fstatvfs().
+		struct Stats {
+
+			uint64_t total = 0;		///< @brief Size of the filesystem in bytes.
+			uint64_t free = 0;		///< @brief Free bytes, including the blocks reserved for root.
+			uint64_t available = 0;	///< @brief Bytes available to unprivileged users.
+			uint64_t inodes = 0;	///< @brief Total inodes (0 if the filesystem has no fixed inode table).
+			uint64_t ifree = 0;		///< @brief Free inodes.
+
+			/// @brief Disk usage in % (0 - 1), as reported by df.
+			float used() const noexcept;
+
+			/// @brief Inode usage in % (0 - 1).
+			float iused() const noexcept;
+
+		};
+
+		/// @brief Create filesystem object.
+		/// @param path The mount point (not opened until the first sample).
+		/// @param timeout Time limit (in ms) for each sample, 0 to wait forever.
+		FileSystem(const char *path, unsigned int timeout = 0);
 		~FileSystem();
 
+		FileSystem(const FileSystem &) = delete;
+		FileSystem & operator=(const FileSystem &) = delete;
+
+		/// @brief Notify all filesystem objects that the mount table has changed.
+		/// @see FileSystem::used()
+		static void remounted() noexcept;
+
+		/// @brief Get filesystem statistics.
+		/// @details Reopen the mount point only if the mount table has changed
+		/// or the handle has gone stale; otherwise it's a single fstatvfs().
+		/// With a timeout the calls run on a small pool of sampling threads; a
+		/// mount point never has more than one pending sample, so a hung NFS or
+		/// CIFS server blocks one thread, not the caller.
+		/// @exception Timeout if the filesystem did not answer in time or the
+		/// previous sample is still blocked.
+		Stats stats();
+
+		/// @brief Is the last sample still blocked?
+		bool unresponsive() const noexcept;
+
 		/// @brief Disk usage in % (0 - 1)
-		float used() const;
+		inline float used() {
+			return stats().used();
+		}
 
 	};
 
@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <cstddef>
+
+ namespace Udjat {
+
+	/// @brief Fixed size ring buffer of timestamped samples with incremental linear regression.
+	/// @details No allocation; push, rate and eta are O(1) (sums are rebuilt every N
+	/// samples around the oldest timestamp to keep precision). Times and values are
+	/// stored as separate float columns, times relative to the origin of the sums,
+	/// half the size of double pairs with plenty of precision for disk usage.
+	template <size_t N>
+	class History {
+	private:
+
+		/// @brief Sample times, in seconds from origin.
+		float times[N];
+
+		/// @brief Sample values.
+		float values[N];
+
+		/// @brief Index of the next sample.
+		unsigned short head = 0;
+
+		/// @brief Number of samples in buffer.
+		unsigned short count = 0;
+
+		/// @brief Samples since the last rebuild of the sums.
+		unsigned short pushed = 0;
+
+		/// @brief Time origin for the sums.
+		double origin = 0;
+
+		/// @brief Regression sums (times relative to origin).
+		double st = 0, sv = 0, stt = 0, stv = 0;
+
+		static_assert(N > 0 && N < 65535, "Invalid history size");
+
+		/// @brief Get buffer position of a sample.
+		/// @param ix Sample index, 0 is the oldest one.
+		inline size_t at(size_t ix) const noexcept {
+			return (head + N - count + ix) % N;
+		}
+
+		void rebuild() noexcept {
+
+			// Move origin to the oldest sample.
+			float delta = times[at(0)];
+			origin += delta;
+			st = sv = stt = stv = 0;
+
+			for(size_t ix = 0; ix < count; ix++) {
+				size_t pos = at(ix);
+				times[pos] -= delta;
+				double t = times[pos];
+				double v = values[pos];
+				st += t;
+				sv += v;
+				stt += t*t;
+				stv += t*v;
+			}
+
+			pushed = 0;
+		}
+
+	public:
+
+		/// @brief Add sample, replacing the oldest one when full.
+		/// @param time Sample time in seconds (monotonic).
+		/// @param value Sample value.
+		void push(double time, double value) noexcept {
+
+			if(count == N) {
+				size_t oldest = at(0);
+				double t = times[oldest];
+				double v = values[oldest];
+				st -= t;
+				sv -= v;
+				stt -= t*t;
+				stv -= t*v;
+				count--;
+			}
+
+			if(!count) {
+				origin = time;
+				st = sv = stt = stv = 0;
+			}
+
+			// The sums use the stored (float) values, so removing them later is exact.
+			times[head] = (float) (time - origin);
+			values[head] = (float) value;
+
+			double t = times[head];
+			double v = values[head];
+
+			head = (head + 1) % N;
+			count++;
+
+			if(++pushed >= N) {
+				rebuild();
+			} else {
+				st += t;
+				sv += v;
+				stt += t*t;
+				stv += t*v;
+			}
+
+		}
+
+		inline size_t size() const noexcept {
+			return count;
+		}
+
+		inline bool empty() const noexcept {
+			return count == 0;
+		}
+
+		/// @brief Remove all samples.
+		inline void clear() noexcept {
+			head = count = pushed = 0;
+		}
+
+		/// @brief Get the least squares slope.
+		/// @return Value change per second (0 if there's not enough samples).
+		double rate() const noexcept {
+
+			if(count < 2) {
+				return 0;
+			}
+
+			double n = (double) count;
+			double den = (n * stt) - (st * st);
+			if(den <= 0) {
+				return 0;
+			}
+
+			return ((n * stv) - (st * sv)) / den;
+
+		}
+
+		/// @brief Estimate the time to reach a value.
+		/// @param limit The value to reach.
+		/// @return Seconds from the last sample to reach the limit, negative if it's not getting closer.
+		double eta(double limit) const noexcept {
+
+			double slope = rate();
+			if(slope <= 0) {
+				return -1;
+			}
+
+			double n = (double) count;
+			double intercept = (sv - (slope * st)) / n;
+			double current = intercept + (slope * times[at(count-1)]);
+
+			if(current >= limit) {
+				return 0;
+			}
+
+			return (limit - current) / slope;
+
+		}
+
+	};
+
+ }
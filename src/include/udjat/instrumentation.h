@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+
+#ifdef HAVE_INSTRUMENTATION
+
+ #include <udjat/request.h>
+ #include <atomic>
+ #include <cstdint>
+ #include <ctime>
+ #include <functional>
+
+ namespace Udjat {
+
+	/// @brief Low overhead counters for the module's hot paths.
+	/// @details Built only with HAVE_INSTRUMENTATION (./configure --disable-instrumentation removes them).
+	namespace Instrumentation {
+
+		/// @brief Monotonic time in microseconds.
+		uint64_t UDJAT_API now() noexcept;
+
+		/// @brief Latency histogram with log2 buckets (bucket n counts samples in [2^n, 2^(n+1)) us).
+		class UDJAT_API Histogram {
+		public:
+			static const size_t buckets = 32;
+
+		private:
+			std::atomic<uint32_t> counts[buckets];
+			std::atomic<uint64_t> total{0};
+			std::atomic<uint64_t> sum{0};
+			std::atomic<uint64_t> max{0};
+
+		public:
+			Histogram();
+
+			/// @brief Add sample.
+			/// @param us The latency in microseconds.
+			void push(uint64_t us) noexcept;
+
+			/// @brief Export histogram.
+			void get(Udjat::Value &value) const;
+
+		};
+
+		/// @brief Per agent refresh counters.
+		struct UDJAT_API Refresh {
+
+			/// @brief Refresh latency.
+			Histogram latency;
+
+			/// @brief Failed refreshes.
+			std::atomic<uint64_t> errors{0};
+
+			/// @brief Refreshes without a sample (mount point unresponsive).
+			std::atomic<uint64_t> timeouts{0};
+
+			/// @brief Time of the last successful sample (monotonic us).
+			std::atomic<uint64_t> last{0};
+
+			/// @brief Export counters.
+			void get(Udjat::Value &value) const;
+
+		};
+
+		/// @brief Process wide syscall counters.
+		struct UDJAT_API Syscalls {
+			std::atomic<uint64_t> open{0};			///< @brief Mount points opened.
+			std::atomic<uint64_t> statvfs{0};		///< @brief fstatvfs() calls.
+			std::atomic<uint64_t> mountinfo{0};		///< @brief Mount table reads.
+			std::atomic<uint64_t> diskstats{0};		///< @brief /proc/diskstats reads.
+
+			/// @brief Export counters.
+			void get(Udjat::Value &value) const;
+		};
+
+		/// @brief Get the syscall counters.
+		UDJAT_API Syscalls & syscalls() noexcept;
+
+		/// @brief Register agent counters (for the information worker).
+		UDJAT_API void insert(const char *name, const Refresh &refresh);
+
+		/// @brief Unregister agent counters.
+		UDJAT_API void remove(const Refresh &refresh) noexcept;
+
+		/// @brief Enumerate registered agent counters.
+		UDJAT_API void for_each(const std::function<void(const char *name, const Refresh &refresh)> &call);
+
+	}
+
+ }
+
+#endif // HAVE_INSTRUMENTATION
@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <sys/types.h>
+ #include <cstdint>
+ #include <functional>
+
+ namespace Udjat {
+
+	/// @brief cgroup v2 I/O accounting (io.stat).
+	class UDJAT_API IOStat {
+	public:
+
+		struct Counters {
+			uint64_t rbytes = 0;	///< @brief Bytes read.
+			uint64_t wbytes = 0;	///< @brief Bytes written.
+			uint64_t rios = 0;		///< @brief Read operations.
+			uint64_t wios = 0;		///< @brief Write operations.
+		};
+
+		/// @brief Parse io.stat contents.
+		/// @param text Lines as '8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=0 dios=0'.
+		/// @param call Callback for each device.
+		static void parse(const char *text, const std::function<void(dev_t dev, const Counters &counters)> &call);
+
+		/// @brief Get the disk of a partition (io.stat reports whole disks).
+		/// @return The disk, or dev itself when it is not a partition.
+		static dev_t disk(dev_t dev) noexcept;
+
+	};
+
+ }
@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <sys/types.h>
+ #include <string>
+ #include <vector>
+ #include <unordered_map>
+
+ namespace Udjat {
+
+	/// @brief Parsed mount table (/proc/self/mountinfo).
+	class UDJAT_API MountInfo {
+	public:
+
+		struct Entry {
+
+			/// @brief Unique mount ID.
+			unsigned int id = 0;
+
+			/// @brief Value of st_dev for files on this filesystem.
+			dev_t dev = 0;
+
+			/// @brief Root of the mount within the filesystem (not '/' for bind mounts and subvolumes).
+			std::string root;
+
+			/// @brief Mount point relative to the process root.
+			std::string mount_point;
+
+			/// @brief Filesystem type.
+			std::string type;
+
+			/// @brief Mount source (device name or 'none').
+			std::string source;
+
+			/// @brief Backing block device, 0 if not a block device.
+			/// @details Taken from the mount's major:minor; only anonymous devices
+			/// (btrfs subvolumes) stat the source for the real one.
+			dev_t device = 0;
+
+		};
+
+	private:
+		std::vector<Entry> entries;
+
+		/// @brief Primary mount for each block device (index in entries).
+		std::unordered_map<dev_t,size_t> index;
+
+		/// @brief Visible mount for each mount point (index in entries).
+		std::unordered_map<std::string,size_t> points;
+
+	public:
+
+		MountInfo() = default;
+
+		/// @brief Load mount table from file.
+		MountInfo(const char *filename);
+
+		/// @brief Parse mountinfo contents, replacing the current entries.
+		void parse(const char *text);
+
+		/// @brief Read mountinfo contents from an open handle (from the beginning).
+		void load(int fd);
+
+		/// @brief Get the entry for a mount point.
+		/// @return The entry or nullptr if the mount point is not in table.
+		const Entry * find(const char *mount_point) const noexcept;
+
+		/// @brief Get the primary mount for a block device.
+		/// @details Prefer the mount of the filesystem root over bind mounts and
+		/// subvolumes; if there's none, the first one mounted.
+		/// @param device The block device (st_rdev).
+		/// @return The entry or nullptr if the device is not mounted.
+		const Entry * find(dev_t device) const noexcept;
+
+		inline size_t size() const noexcept {
+			return entries.size();
+		}
+
+		inline std::vector<Entry>::const_iterator begin() const noexcept {
+			return entries.begin();
+		}
+
+		inline std::vector<Entry>::const_iterator end() const noexcept {
+			return entries.end();
+		}
+
+	};
+
+ }
@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <sys/types.h>
+ #include <cstdint>
+ #include <string>
+ #include <vector>
+
+ namespace Udjat {
+
+	/// @brief Per-process storage I/O (read_bytes/write_bytes from /proc/[pid]/io).
+	/// @details Counters are kept in two pid-indexed open addressing tables
+	/// (previous and current sample), swapped on every sample; memory is only
+	/// allocated when the number of processes grows.
+	class UDJAT_API ProcessIO {
+	public:
+
+		/// @brief Process with the highest I/O rates.
+		struct Talker {
+			pid_t pid = 0;
+			char comm[16];			///< @brief Command name (from /proc/[pid]/comm).
+			double read = 0;		///< @brief Bytes read per second.
+			double write = 0;		///< @brief Bytes written per second.
+		};
+
+	private:
+
+		/// @brief Process directory (/proc).
+		std::string path;
+
+		/// @brief Number of talkers to keep.
+		size_t limit;
+
+		struct Slot {
+			pid_t pid;		///< @brief 0 if empty.
+			uint64_t read;
+			uint64_t write;
+		};
+
+		struct Table {
+			std::vector<Slot> slots;		///< @brief Power of 2 capacity, at most half full.
+			size_t count = 0;
+
+			/// @brief Find slot for pid (the empty slot where it would be inserted if not found).
+			inline Slot & at(pid_t pid) noexcept {
+				size_t mask = slots.size() - 1;
+				size_t ix = (((size_t) pid) * 2654435761U) & mask;
+				while(slots[ix].pid && slots[ix].pid != pid) {
+					ix = (ix + 1) & mask;
+				}
+				return slots[ix];
+			}
+
+			/// @brief Empty table with room for 'count' processes.
+			void reset(size_t count);
+
+			/// @brief Double the capacity, keeping the slots.
+			void grow();
+
+		} tables[2];
+
+		/// @brief Index of the table with the last sample.
+		size_t current = 0;
+
+		/// @brief Time of the last sample (monotonic, in seconds).
+		double timestamp = 0;
+
+		/// @brief Candidates of the last sample, reused.
+		std::vector<Talker> candidates;
+
+		/// @brief Top-K of the last sample.
+		std::vector<Talker> talkers;
+
+		/// @brief Processes seen in the last sample.
+		size_t processes = 0;
+
+	public:
+		/// @param limit Number of talkers to keep.
+		/// @param path Process directory.
+		ProcessIO(size_t limit = 10, const char *path = "/proc");
+
+		/// @brief Read the counters of every process, update the top talkers.
+		void sample();
+
+		/// @brief Get the top talkers, highest read + write rate first.
+		inline const std::vector<Talker> & top() const noexcept {
+			return talkers;
+		}
+
+		/// @brief Get the number of processes in the last sample.
+		inline size_t size() const noexcept {
+			return processes;
+		}
+
+	};
+
+ }
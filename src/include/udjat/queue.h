@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <sys/types.h>
+ #include <cstdint>
+ #include <string>
+ #include <vector>
+
+ namespace Udjat {
+
+	/// @brief Block queue settings of a disk (/sys/block/[disk]/queue).
+	class UDJAT_API Queue {
+	public:
+
+		/// @brief Expected setting for a class of disks.
+		struct Rule {
+			std::string device;			///< @brief Disk type (nvme, ssd, hdd, virtual), disk name or '*'.
+			std::string attribute;		///< @brief Queue attribute (scheduler, read_ahead_kb, ...).
+			std::string value;			///< @brief Accepted values ('|' separated), the first one is recommended.
+			uint64_t min = 0;			///< @brief Lowest accepted number (0 for no limit).
+			uint64_t max = 0;			///< @brief Highest accepted number (0 for no limit).
+
+			/// @brief Check the rule against a queue.
+			/// @param current The current value of the attribute.
+			/// @return The recommended value, empty if the current one is accepted.
+			std::string check(const std::string &current) const;
+
+		};
+
+		/// @brief Setting that doesn't match a rule.
+		struct Mismatch {
+			std::string attribute;
+			std::string current;
+			std::string recommended;
+		};
+
+	private:
+
+		/// @brief The queue directory.
+		std::string path;
+
+		/// @brief Disk name.
+		std::string disk;
+
+		/// @brief Disk type (for the rules).
+		const char *type;
+
+	public:
+
+		/// @param disk The disk name (sda, nvme0n1, ...).
+		/// @param sysfs The sysfs root (a fake tree for testing).
+		Queue(const char *disk, const char *sysfs = "/sys");
+
+		/// @brief Get the disk name of a block device, partitions resolved to their disk.
+		/// @param dev The block device.
+		/// @param sysfs The sysfs root.
+		/// @return The disk name, empty if unknown.
+		static std::string name(dev_t dev, const char *sysfs = "/sys");
+
+		/// @brief Get the member disks of a virtual device (device mapper, md), partitions resolved to their disk.
+		/// @param disk The device name (dm-0, md127, ...).
+		/// @param sysfs The sysfs root.
+		/// @return The physical disks under the device, empty if it has no members.
+		static std::vector<std::string> members(const char *disk, const char *sysfs = "/sys");
+
+		/// @brief The default rules (scheduler, read_ahead_kb, nr_requests, max_sectors_kb and write_cache by disk type).
+		static const std::vector<Rule> & defaults();
+
+		inline const char * name() const noexcept {
+			return disk.c_str();
+		}
+
+		/// @brief Get disk type.
+		/// @return 'nvme', 'ssd', 'hdd' or 'virtual' (loop, zram, device mapper and md; the default rules don't
+		/// apply to them, their member disks are checked on their own, see members()).
+		inline const char * getType() const noexcept {
+			return type;
+		}
+
+		/// @brief Read a queue attribute (the active one for 'scheduler').
+		/// @return The value, empty if the attribute doesn't exist.
+		std::string get(const char *attribute) const;
+
+		/// @brief Evaluate rules.
+		/// @return The settings that don't match the rules for this disk.
+		std::vector<Mismatch> check(const std::vector<Rule> &rules) const;
+
+	};
+
+ }
@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <cstdint>
+ #include <functional>
+
+ namespace Udjat {
+
+	/// @brief Disk quotas of a filesystem.
+	class UDJAT_API Quota {
+	public:
+
+		enum Type : uint8_t {
+			User = 0,
+			Group = 1,
+			Project = 2
+		};
+
+		struct Entry {
+			Type type = User;
+			uint32_t id = 0;
+
+			uint64_t space = 0;			///< @brief Bytes in use.
+			uint64_t space_soft = 0;	///< @brief Soft limit in bytes (0 if none).
+			uint64_t space_hard = 0;	///< @brief Hard limit in bytes (0 if none).
+
+			uint64_t inodes = 0;		///< @brief Inodes in use.
+			uint64_t inodes_soft = 0;	///< @brief Soft inode limit (0 if none).
+			uint64_t inodes_hard = 0;	///< @brief Hard inode limit (0 if none).
+
+			/// @brief Usage in % of the nearest limit (space or inodes, soft before hard), 0 without limits.
+			float percent() const noexcept;
+
+		};
+
+		/// @brief Get quota type name.
+		static const char * name(Type type) noexcept;
+
+		/// @brief Get every id with quota information.
+		/// @details Uses Q_GETNEXTQUOTA (Q_XGETNEXTQUOTA on XFS), one call per id
+		/// with quota information instead of one per possible id.
+		/// @param device The block device with the filesystem.
+		/// @param type The quota type.
+		/// @param call Called for each id.
+		/// @return false if quotas of this type are not enabled.
+		static bool get(const char *device, Type type, const std::function<void(const Entry &entry)> &call);
+
+	};
+
+ }
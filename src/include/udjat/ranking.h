@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <cstddef>
+ #include <algorithm>
+ #include <unordered_map>
+ #include <vector>
+
+ namespace Udjat {
+
+	/// @brief Bounded set of the N highest scored items (min-heap with a key index).
+	/// @details Insert, update and remove are O(log N); an item already ranked is
+	/// updated in place, a new one only enters by replacing the lowest score.
+	template <typename K, typename T>
+	class Ranking {
+	public:
+
+		struct Item {
+			K key;
+			double score;
+			T data;
+		};
+
+	private:
+
+		size_t limit;
+		std::vector<Item> heap;
+
+		/// @brief Heap position by key.
+		std::unordered_map<K,size_t> index;
+
+		void exchange(size_t a, size_t b) {
+			std::swap(heap[a],heap[b]);
+			index[heap[a].key] = a;
+			index[heap[b].key] = b;
+		}
+
+		void up(size_t ix) {
+			while(ix) {
+				size_t parent = (ix - 1) / 2;
+				if(heap[parent].score <= heap[ix].score) {
+					break;
+				}
+				exchange(parent,ix);
+				ix = parent;
+			}
+		}
+
+		void down(size_t ix) {
+			for(;;) {
+				size_t smallest = ix;
+				size_t left = (2 * ix) + 1;
+				size_t right = left + 1;
+				if(left < heap.size() && heap[left].score < heap[smallest].score) {
+					smallest = left;
+				}
+				if(right < heap.size() && heap[right].score < heap[smallest].score) {
+					smallest = right;
+				}
+				if(smallest == ix) {
+					break;
+				}
+				exchange(smallest,ix);
+				ix = smallest;
+			}
+		}
+
+	public:
+		Ranking(size_t l) : limit(l) {
+			heap.reserve(limit);
+			index.reserve(limit);
+		}
+
+		/// @brief Would an item with this score be ranked?
+		inline bool accepts(double score) const noexcept {
+			return limit && (heap.size() < limit || score > heap.front().score);
+		}
+
+		/// @brief Is the key ranked?
+		inline bool contains(const K &key) const noexcept {
+			return index.find(key) != index.end();
+		}
+
+		/// @brief Insert or update an item.
+		/// @return false if the item is not ranked.
+		bool set(const K &key, double score, const T &data) {
+
+			auto it = index.find(key);
+			if(it != index.end()) {
+				size_t ix = it->second;
+				heap[ix].score = score;
+				heap[ix].data = data;
+				up(ix);
+				down(index[key]);
+				return true;
+			}
+
+			if(!accepts(score)) {
+				return false;
+			}
+
+			if(heap.size() < limit) {
+				heap.push_back(Item{key,score,data});
+				index[key] = heap.size() - 1;
+				up(heap.size() - 1);
+			} else {
+				index.erase(heap.front().key);
+				heap.front() = Item{key,score,data};
+				index[key] = 0;
+				down(0);
+			}
+
+			return true;
+
+		}
+
+		/// @brief Remove item.
+		void erase(const K &key) {
+
+			auto it = index.find(key);
+			if(it == index.end()) {
+				return;
+			}
+
+			size_t ix = it->second;
+			size_t last = heap.size() - 1;
+			if(ix != last) {
+				exchange(ix,last);
+			}
+
+			index.erase(key);
+			heap.pop_back();
+
+			if(ix < heap.size()) {
+				up(ix);
+				down(ix);
+			}
+
+		}
+
+		/// @brief Get items, highest score first.
+		std::vector<Item> sorted() const {
+			std::vector<Item> items{heap};
+			std::sort(items.begin(),items.end(),[](const Item &a, const Item &b){
+				return a.score > b.score;
+			});
+			return items;
+		}
+
+		inline size_t size() const noexcept {
+			return heap.size();
+		}
+
+		/// @brief Get the maximum number of items.
+		inline size_t capacity() const noexcept {
+			return limit;
+		}
+
+		inline bool empty() const noexcept {
+			return heap.empty();
+		}
+
+		void clear() noexcept {
+			heap.clear();
+			index.clear();
+		}
+
+	};
+
+ }
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/agent.h>
+ #include <udjat/diskusage.h>
+ #include <pugixml.hpp>
+ #include <atomic>
+ #include <memory>
+ #include <string>
+ #include <vector>
+
+ /// @brief Size of the top-level subdirectories of a path (du -x).
+ class UDJAT_API UsageAgent : public Udjat::Abstract::Agent {
+ public:
+
+	/// @brief Size of a top-level subdirectory.
+	class Directory;
+
+ private:
+
+	/// @brief Path to scan.
+	const char *path;
+
+	/// @brief Refreshes between full rescans (to see files grown in place), 0 to never rescan.
+	unsigned int rescan = 24;
+	unsigned int scans = 0;
+
+	/// @brief State of the background scan, shared with its thread (it may outlive the agent).
+	/// @details Keeps the scanner (and its per-directory cache) between refreshes.
+	struct Scan;
+	std::shared_ptr<Scan> scan;
+
+	/// @brief Agents for the top-level subdirectories.
+	std::vector<std::shared_ptr<Directory>> directories;
+
+	/// @brief Total of the last scan.
+	std::atomic<uint64_t> total{0};
+
+	/// @brief Update the subdirectory agents from a finished scan.
+	void publish(const std::vector<Udjat::DiskUsage::Entry> &entries);
+
+ public:
+	UsageAgent(const char *path, const char *name, const pugi::xml_node &node);
+	virtual ~UsageAgent();
+
+	/// @brief Start a background scan of the path, the subdirectory agents are updated when it finishes.
+	bool refresh() override;
+
+	/// @brief Get total size as string.
+	std::string to_string() const noexcept override;
+
+ };
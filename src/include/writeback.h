@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #pragma once
+
+ #include <udjat/defs.h>
+ #include <udjat/agent.h>
+ #include <udjat/mountinfo.h>
+ #include <pugixml.hpp>
+ #include <cstdint>
+ #include <mutex>
+ #include <string>
+ #include <unordered_map>
+ #include <vector>
+
+ /// @brief Dirty page cache and writeback, system wide and per backing device.
+ /// @details The value is the dirty memory (including pages under writeback) as
+ /// % of the dirty threshold, where balance_dirty_pages() blocks the writers;
+ /// the default states are placed on the kernel's own background and throttling
+ /// thresholds. The per-device figures come from the bdi stats and are mapped to
+ /// the mount points of each disk.
+ class UDJAT_API WritebackAgent : public Udjat::Agent<float> {
+ public:
+
+	/// @brief Dirty data and write rate.
+	struct Backlog {
+		uint64_t dirty = 0;			///< @brief Dirty bytes, not yet submitted.
+		uint64_t writeback = 0;		///< @brief Bytes under writeback.
+		uint64_t written = 0;		///< @brief Bytes written (cumulative).
+		float rate = 0;				///< @brief Bytes written per second.
+
+		/// @brief Estimate time to write the backlog.
+		/// @param bandwidth Write rate to assume if nothing was written since the last sample.
+		/// @return Seconds to drain, 0 if clean, negative if nothing is being written.
+		double drain(float bandwidth = 0) const noexcept;
+	};
+
+ private:
+
+	mutable std::mutex guard;
+
+	/// @brief System wide backlog (/proc/meminfo and /proc/vmstat).
+	Backlog total;
+
+	/// @brief Dirty threshold, background writeback threshold (bytes).
+	uint64_t threshold = 0;
+	uint64_t background = 0;
+
+	/// @brief Per backing device backlog.
+	struct Device : public Backlog {
+		dev_t dev;
+		float bandwidth = 0;		///< @brief Kernel estimate of the write bandwidth (bytes/s).
+		Device(dev_t d) : dev(d) {
+		}
+	};
+
+	std::vector<Device> devices;
+
+	/// @brief Directory with the per-bdi 'stats' files, empty if the kernel doesn't expose them.
+	std::string bdi;
+
+	/// @brief Mount points of each backing device.
+	std::unordered_map<dev_t,std::string> mounts;
+
+	/// @brief Time of the last sample.
+	double timestamp = 0;
+
+	/// @brief Get the system wide backlog and thresholds.
+	void global(double elapsed);
+
+	/// @brief Get the per-bdi backlog.
+	void bdis(double elapsed);
+
+ public:
+	typedef Udjat::Agent<float> super;
+
+	/// @param name The agent name.
+	/// @param node Configuration ('update-timer' attribute).
+	WritebackAgent(const char *name, const pugi::xml_node &node);
+	virtual ~WritebackAgent();
+
+	/// @brief Push the default states (from the current thresholds).
+	void start() override;
+
+	bool refresh() override;
+
+	/// @brief Update the backing device to mount point mapping.
+	void set(const Udjat::MountInfo &mounts);
+
+	/// @brief Export the system wide and per device backlog.
+	void report(Udjat::Value &value) const;
+
+	void get(const Udjat::Request &request, Udjat::Response &response) override;
+
+	std::string to_string() const noexcept override;
+
+ };
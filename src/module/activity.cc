@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/activity.h>
+ #include <system_error>
+ #include <cerrno>
+ #include <fcntl.h>
+ #include <unistd.h>
+
+#ifdef HAVE_FANOTIFY
+ #include <sys/fanotify.h>
+#endif // HAVE_FANOTIFY
+
+ using namespace std;
+
+ namespace Udjat {
+
+#ifdef HAVE_FANOTIFY
+
+	Activity::Activity(const char *path, bool descriptors) {
+
+		// Delete events need FID reporting (5.1+); without it the events carry
+		// open descriptors, closed by drain().
+		uint64_t mask = FAN_MODIFY|FAN_CLOSE_WRITE;
+
+#ifdef FAN_REPORT_FID
+		if(!descriptors) {
+			fd = fanotify_init(FAN_CLASS_NOTIF|FAN_CLOEXEC|FAN_NONBLOCK|FAN_REPORT_FID,O_RDONLY|O_LARGEFILE);
+			if(fd >= 0) {
+				mask |= FAN_DELETE;
+			}
+		}
+#else
+		(void) descriptors;
+#endif // FAN_REPORT_FID
+
+		if(fd < 0) {
+			fd = fanotify_init(FAN_CLASS_NOTIF|FAN_CLOEXEC|FAN_NONBLOCK,O_RDONLY|O_LARGEFILE);
+		}
+
+		if(fd < 0) {
+			throw system_error(errno,system_category(),"fanotify_init");
+		}
+
+		if(fanotify_mark(fd,FAN_MARK_ADD|FAN_MARK_FILESYSTEM,mask,AT_FDCWD,path)) {
+			int err = errno;
+			::close(fd);
+			fd = -1;
+			throw system_error(err,system_category(),path);
+		}
+
+	}
+
+	size_t Activity::drain() noexcept {
+		return drain([](int){});
+	}
+
+	size_t Activity::drain(const std::function<void(int fd)> &call) {
+
+		size_t events = 0;
+		alignas(struct fanotify_event_metadata) char buffer[8192];
+
+		ssize_t length;
+		while((length = read(fd,buffer,sizeof(buffer))) > 0) {
+
+			const struct fanotify_event_metadata *event = (const struct fanotify_event_metadata *) buffer;
+			while(FAN_EVENT_OK(event,length)) {
+				if(event->fd >= 0) {
+					try {
+						call(event->fd);
+					} catch(...) {
+						::close(event->fd);
+						throw;
+					}
+					::close(event->fd);
+				}
+				events++;
+				event = FAN_EVENT_NEXT(event,length);
+			}
+
+		}
+
+		return events;
+
+	}
+
+#else
+
+	Activity::Activity(const char *path, bool) {
+		throw system_error(ENOSYS,system_category(),path);
+	}
+
+	size_t Activity::drain() noexcept {
+		return 0;
+	}
+
+	size_t Activity::drain(const std::function<void(int fd)> &) {
+		return 0;
+	}
+
+#endif // HAVE_FANOTIFY
+
+	Activity::~Activity() {
+		if(fd >= 0) {
+			::close(fd);
+		}
+	}
+
+ }
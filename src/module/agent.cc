@@ -21,10 +21,17 @@
  #include <agent.h>
  #include <udjat/tools/quark.h>
  #include <udjat/filesystem.h>
+ #include <udjat/tools/mainloop.h>
  #include <udjat/tools/intl.h>
  #include <iostream>
  #include <sstream>
  #include <iomanip>
+ #include <limits>
+ #include <cmath>
+ #include <ctime>
+ #include <atomic>
+ #include <system_error>
+ #include <sys/stat.h>
 
  using namespace std;
 
@@ -226,34 +233,502 @@
 
  };
 
- static const char * getNameFromMP(const char *mp, const char *name) {
+ std::shared_ptr<const Agent::Metadata> Agent::Metadata::build(const char *mp, const char *label, const char *device, const char *type, dev_t dev) {
 
-	if(name && *name) {
-		return name;
+	auto metadata = make_shared<Metadata>();
+
+	metadata->dev = dev;
+	metadata->mount_point = mp;
+	metadata->device = device;
+	metadata->type = type;
+	metadata->label = label;
+
+	if(label && *label) {
+		metadata->name = label;
+		return metadata;
 	}
 
 	for(size_t ix = 0; ix < (sizeof(sysdefs)/sizeof(sysdefs[0])); ix++) {
 
 		if(!strcasecmp(mp,sysdefs[ix].mp)) {
-			return sysdefs[ix].name;
+			metadata->name = sysdefs[ix].name;
+			return metadata;
 		}
 
 	}
 
 	const char *ptr = strrchr(mp,'/');
-	if(ptr)
-		return Udjat::Quark(ptr+1).c_str();
+	metadata->name = ((ptr && ptr[1]) ? ptr+1 : mp);
 
-	return Udjat::Quark(mp).c_str();
+	return metadata;
 
  }
 
- Agent::Agent(const char * m, const char *name) : Udjat::Agent<float>(getNameFromMP(m,name)), mount_point(m) {
+ /// @brief Bytes available to unprivileged users, from the parent's sample.
+ class Agent::Available : public Udjat::Agent<unsigned long long> {
+ public:
+	Available() : Udjat::Agent<unsigned long long>("available") {
+		Object::properties.label = _( "Available space" );
+	}
+
+	std::string to_string() const noexcept override {
+
+		static const char *units[] = { "B", "KB", "MB", "GB", "TB", "PB" };
+
+		double value = (double) get();
+		size_t ix = 0;
+		while(value >= 1024.0 && ix < ((sizeof(units)/sizeof(units[0]))-1)) {
+			value /= 1024.0;
+			ix++;
+		}
+
+		std::stringstream out;
+		out << std::fixed << std::setprecision(2) << value << " " << units[ix];
+		return out.str();
+
+	}
+
+ };
+
+ /// @brief Inode usage, from the parent's sample.
+ class Agent::Inodes : public Udjat::Agent<float> {
+ private:
+
+	/// @brief Expanded state texts.
+	std::vector<Udjat::Atom> texts;
+
+ public:
+	Inodes() : Udjat::Agent<float>("inodes") {
+		Object::properties.label = _( "Inode usage" );
+	}
+
+	void start() override;
+
+	size_t memory() const noexcept {
+		size_t bytes = sizeof(*this) + (texts.capacity() * sizeof(Udjat::Atom)) + (states.size() * sizeof(Udjat::State<float>));
+		for(const auto &text : texts) {
+			bytes += text.size() + 1;
+		}
+		return bytes;
+	}
+
+	std::string to_string() const noexcept override {
+		std::stringstream out;
+		out << std::fixed << std::setprecision(2) << get() << "%";
+		return out.str();
+	}
+
+ };
+
+ /// @brief Usage growth in %/hour, from the parent's history.
+ class Agent::Growth : public Udjat::Agent<float> {
+ public:
+	Growth() : Udjat::Agent<float>("growth") {
+		Object::properties.label = _( "Usage growth" );
+	}
+
+	std::string to_string() const noexcept override {
+		std::stringstream out;
+		out << std::fixed << std::setprecision(2) << get() << "%/h";
+		return out.str();
+	}
+
+ };
+
+ /// @brief Estimated time to full in hours, from the parent's history.
+ class Agent::Forecast : public Udjat::Agent<float> {
+ public:
+	Forecast() : Udjat::Agent<float>("time-to-full", std::numeric_limits<float>::infinity()) {
+		Object::properties.label = _( "Time to full" );
+	}
+
+	void start() override {
+
+		if(states.empty()) {
+
+			static const struct {
+				float from;
+				float to;
+				const char 						* name;			///< @brief State name.
+				Udjat::Level					  level;		///< @brief State level.
+				const char						* summary;		///< @brief State summary.
+			} states[] = {
+				{
+					0.0,
+					1.0,
+					"filling",
+					Udjat::error,
+					N_( "${name} will be full in less than one hour" ),
+				},
+				{
+					1.0,
+					24.0,
+					"lt24h",
+					Udjat::warning,
+					N_( "${name} will be full in less than one day" ),
+				},
+				{
+					24.0,
+					std::numeric_limits<float>::infinity(),
+					"stable",
+					Udjat::ready,
+					"",
+				}
+			};
+
+			for(size_t ix = 0; ix < (sizeof(states)/ sizeof(states[0])); ix++) {
+
+				push_back(
+					make_shared<Udjat::State<float>>(
+						states[ix].name,
+						states[ix].from,
+						states[ix].to,
+						states[ix].level,
+#ifdef GETTEXT_PACKAGE
+						Udjat::Quark(expand(dgettext(GETTEXT_PACKAGE,states[ix].summary))).c_str(),
+#else
+						Udjat::Quark(expand(states[ix].summary)).c_str(),
+#endif
+						""
+					)
+				);
+
+			}
+
+		}
+
+		Udjat::Abstract::Agent::start();
+
+	}
+
+	std::string to_string() const noexcept override {
+
+		float hours = get();
+		if(std::isinf(hours)) {
+			return _( "never" );
+		}
+
+		std::stringstream out;
+		out << std::fixed << std::setprecision(1) << hours << "h";
+		return out.str();
+	}
+
+ };
+
+ /// @brief Write/fsync latency (p99 in ms) from the canary probes.
+ class Agent::Latency : public Udjat::Agent<float> {
+ private:
+
+	Udjat::Canary canary;
+
+	const float regression;
+	const float floor;
+	const unsigned short timeout;
+
+	/// @brief Usual p99 (ms), slowly following the latency while it isn't regressed.
+	float baseline = 0;
+
+	/// @brief Expanded state texts.
+	std::vector<Udjat::Atom> texts;
+
+	std::shared_ptr<Udjat::Abstract::State> slow;
+	std::shared_ptr<Udjat::Abstract::State> stalled;
+
+	static Udjat::Canary::Options options(const char *mount_point, const ::Agent::Canary &settings) {
+
+		Udjat::Canary::Options options = settings;
+
+		if(options.directory[0] != '/') {
+			options.directory.insert(0,string{mount_point} + "/");
+		}
+
+		if(mkdir(options.directory.c_str(),0700) && errno != EEXIST) {
+			throw std::system_error(errno,std::system_category(),options.directory);
+		}
+
+		return options;
+
+	}
+
+ protected:
+
+	std::shared_ptr<Udjat::Abstract::State> stateFromValue() const override {
+
+		if(stalled && canary.pending() > timeout) {
+			return stalled;
+		}
+
+		float value = Udjat::Agent<float>::get();
+		if(slow && baseline > 0 && value >= floor && value > (baseline * regression)) {
+			return slow;
+		}
+
+		return Udjat::Agent<float>::stateFromValue();
+
+	}
+
+ public:
+	Latency(const char *mount_point, const ::Agent::Canary &settings)
+		: Udjat::Agent<float>("latency"), canary(options(mount_point,settings)), regression(settings.regression), floor(settings.floor), timeout(settings.timeout) {
+		Object::properties.label = _( "Write latency" );
+		update.timer = settings.interval;
+	}
+
+	void start() override {
+
+		if(states.empty()) {
+			push_back(make_shared<Udjat::State<float>>("normal",0.0,std::numeric_limits<float>::max(),Udjat::ready,_( "Write latency is normal" ),""));
+		}
+
+		if(!slow) {
+			texts.emplace_back(expand(_( "${name} p99 is above its usual value" )));
+			slow = make_shared<Udjat::Abstract::State>("slow",Udjat::warning,texts.back().c_str());
+			texts.emplace_back(expand(_( "${name} probe is not completing" )));
+			stalled = make_shared<Udjat::Abstract::State>("stalled",Udjat::error,texts.back().c_str());
+		}
+
+		Udjat::Abstract::Agent::start();
+
+	}
+
+	bool refresh() override {
+
+		Udjat::Canary::Percentiles write = canary.write();
+
+		if(write.samples) {
+
+			float p99 = ((float) write.p99) / 1000;
+
+			if(!baseline) {
+				// Wait for a few probes before trusting the baseline.
+				if(write.samples >= 10) {
+					baseline = p99;
+				}
+			} else if(p99 <= (baseline * regression)) {
+				baseline += (p99 - baseline) / 20;
+			}
+
+			set(p99);
+
+		}
+
+		// One probe per refresh, skipped while the previous one is running.
+		canary.probe();
+
+		auto state = stateFromValue();
+		if(state != this->state()) {
+			activate(state);
+		}
+
+		return true;
+
+	}
+
+	void get(const Udjat::Request &request, Udjat::Response &response) override {
+
+		Udjat::Agent<float>::get(request,response);
+
+		auto export_percentiles = [](Udjat::Value &value, const Udjat::Canary::Percentiles &percentiles) {
+			value["samples"] = (unsigned long long) percentiles.samples;
+			value["p50"] = (unsigned int) percentiles.p50;		// us
+			value["p90"] = (unsigned int) percentiles.p90;
+			value["p99"] = (unsigned int) percentiles.p99;
+		};
+
+		export_percentiles(response["write"],canary.write());
+		export_percentiles(response["read"],canary.read());
+
+		response["baseline"] = baseline;		// ms
+		response["errors"] = (unsigned long long) canary.errors();
+		response["skipped"] = (unsigned long long) canary.skipped();
+
+	}
+
+	std::string to_string() const noexcept override {
+		std::stringstream out;
+		out << std::fixed << std::setprecision(2) << Udjat::Agent<float>::get() << "ms";
+		return out.str();
+	}
+
+ };
+
+ Agent::Agent(std::shared_ptr<const Metadata> metadata) : Udjat::Agent<float>(metadata->name.c_str()), disk(metadata) {
  	setup();
  }
 
- Agent::Agent(const char * m, const char *n, const pugi::xml_node UDJAT_UNUSED(&node)) : Udjat::Agent<float>(getNameFromMP(m,n)), mount_point(m) {
-	setup();
+ Agent::Agent(const char * m, const char *name) : Agent(Metadata::build(m,name)) {
+ }
+
+ Agent::Agent(const char * m, const char *n, const pugi::xml_node &node) : Agent(Metadata::build(m,n)) {
+
+	// Custom states, get boundaries for the adaptive interval.
+	for(auto state : node.children("state")) {
+		boundaries.push_back(state.attribute("from").as_float(0));
+		boundaries.push_back(state.attribute("to").as_float(100));
+	}
+
+	setInterval(Interval(node));
+	setTimeout(node.attribute("sample-timeout").as_uint(timeout));
+
+	if(node.attribute("watch-writes").as_bool(false)) {
+		setWatch((unsigned short) node.attribute("watch-window").as_uint(5));
+	}
+
+	setCanary(Canary(node));
+
+ }
+
+ Agent::Canary::Canary(const pugi::xml_node &node) {
+
+	directory = node.attribute("canary").as_string();
+	size = node.attribute("canary-size").as_uint(size);
+	interval = (unsigned short) node.attribute("canary-interval").as_uint(interval);
+	rate = node.attribute("canary-rate").as_uint(rate);
+	direct = node.attribute("canary-direct").as_bool(direct);
+	window = node.attribute("canary-window").as_uint(window);
+	regression = node.attribute("canary-regression").as_float(regression);
+	floor = node.attribute("canary-min-latency").as_float(floor);
+	timeout = (unsigned short) node.attribute("canary-timeout").as_uint(timeout);
+
+ }
+
+ void Agent::setCanary(const Canary &canary) {
+
+	if(canary.directory.empty() || latency) {
+		return;
+	}
+
+	try {
+
+		latency = make_shared<Latency>(getMountPoint(),canary);
+		Udjat::Abstract::Agent::push_back(latency);
+
+	} catch(const std::exception &e) {
+
+		latency.reset();
+		warning() << "Can't start write canary (" << e.what() << ")" << endl;
+
+	}
+
+ }
+
+ void Agent::setWatch(unsigned short window) noexcept {
+	watch.window = window;
+ }
+
+ void Agent::setTimeout(unsigned int ms) noexcept {
+	timeout = ms;
+	filesystem.reset();
+ }
+
+ Agent::Interval::Interval(const pugi::xml_node &node) {
+
+	min = (unsigned short) node.attribute("min-update-timer").as_uint(0);
+	max = (unsigned short) node.attribute("max-update-timer").as_uint(0);
+
+	if(max && min > max) {
+		min = max;
+	}
+
+ }
+
+ void Agent::setInterval(const Interval &i) noexcept {
+
+	interval = i;
+
+	if(interval.max) {
+		// Start fast, slow down when usage is stable.
+		update.timer = (interval.min ? interval.min : 1);
+	}
+
+ }
+
+ /// @brief Push the default usage states.
+ /// @param agent The agent to update.
+ /// @param boundaries The state boundaries (for the adaptive interval).
+ /// @param texts Keeps the expanded state texts (released with the agent).
+ static void defaults(Udjat::Agent<float> &agent, std::vector<float> &boundaries, std::vector<Udjat::Atom> &texts) {
+
+	static const struct {
+		float from;
+		float to;
+		const char 						* name;			///< @brief State name.
+		Udjat::Level					  level;		///< @brief State level.
+		const char						* summary;		///< @brief State summary.
+		const char						* body;			///< @brief State description
+	} states[] = {
+		{
+			0.0,
+			70.0,
+			"good",
+			Udjat::ready,
+			N_( "${name} usage is less than 70%" ),
+			""
+		},
+		{
+			70.0,
+			90.0,
+			"gt70",
+			Udjat::warning,
+			N_( "${name} usage is greater than 70%" ),
+			""
+		},
+		{
+			90.0,
+			98.0,
+			"gt90",
+			Udjat::error,
+			N_( "${name} usage is greater than 90%" ),
+			""
+		},
+		{
+			98.0,
+			100,
+			"full",
+			Udjat::error,
+			N_( "${name} is full" ),
+			""
+		}
+	};
+
+	agent.info() << "Using default states" << endl;
+
+	for(size_t ix = 0; ix < (sizeof(states)/ sizeof(states[0])); ix++) {
+
+		boundaries.push_back(states[ix].to);
+
+#ifdef GETTEXT_PACKAGE
+		texts.emplace_back(agent.expand(dgettext(GETTEXT_PACKAGE,states[ix].summary)));
+		texts.emplace_back(agent.expand(dgettext(GETTEXT_PACKAGE,states[ix].body)));
+#else
+		texts.emplace_back(agent.expand(states[ix].summary));
+		texts.emplace_back(agent.expand(states[ix].body));
+#endif
+
+		agent.push_back(
+			make_shared<Udjat::State<float>>(
+				states[ix].name,
+				states[ix].from,
+				states[ix].to,
+				states[ix].level,
+				texts[texts.size()-2].c_str(),
+				texts[texts.size()-1].c_str()
+			)
+		);
+
+	}
+
+ }
+
+ void Agent::Inodes::start() {
+
+	if(states.empty()) {
+		std::vector<float> boundaries;
+		defaults(*this,boundaries,texts);
+	}
+
+	Udjat::Abstract::Agent::start();
+
  }
 
  void Agent::start() {
@@ -262,81 +737,69 @@
 		//
 		// No custom states, use the default ones.
 		//
-		static const struct {
-			float from;
-			float to;
-			const char 						* name;			///< @brief State name.
-			Udjat::Level					  level;		///< @brief State level.
-			const char						* summary;		///< @brief State summary.
-			const char						* body;			///< @brief State description
-		} states[] = {
-			{
-				0.0,
-				70.0,
-				"good",
-				Udjat::ready,
-				N_( "${name} usage is less than 70%" ),
-				""
-			},
-			{
-				70.0,
-				90.0,
-				"gt70",
-				Udjat::warning,
-				N_( "${name} usage is greater than 70%" ),
-				""
-			},
-			{
-				90.0,
-				98.0,
-				"gt90",
-				Udjat::error,
-				N_( "${name} usage is greater than 90%" ),
-				""
-			},
-			{
-				98.0,
-				100,
-				"full",
-				Udjat::error,
-				N_( "${name} is full" ),
-				""
-			}
-		};
+		boundaries.clear();
+		defaults(*this,boundaries,texts);
+	}
 
-		info() << "Using default states" << endl;
+	Udjat::Abstract::Agent::start();
 
-		for(size_t ix = 0; ix < (sizeof(states)/ sizeof(states[0])); ix++) {
+	if(watch.window && !activity) {
 
-			push_back(
-				make_shared<Udjat::State<float>>(
-					states[ix].name,
-					states[ix].from,
-					states[ix].to,
-					states[ix].level,
-#ifdef GETTEXT_PACKAGE
-					Udjat::Quark(expand(dgettext(GETTEXT_PACKAGE,states[ix].summary))).c_str(),
-					Udjat::Quark(expand(dgettext(GETTEXT_PACKAGE,states[ix].body))).c_str()
-#else
-					Udjat::Quark(expand(states[ix].summary)).c_str(),
-					Udjat::Quark(expand(states[ix].body)).c_str()
-#endif
-				)
-			);
+		try {
+
+			activity.reset(new Udjat::Activity(getMountPoint()));
+
+			Udjat::MainLoop::getInstance().insert(this,activity->descriptor(),Udjat::MainLoop::oninput,[this](const Udjat::MainLoop::Event) {
+				activity->drain();
+				written();
+				return true;
+			});
+
+			info() << "Refreshing on write activity" << endl;
+
+		} catch(const std::exception &e) {
+
+			activity.reset();
+			warning() << "Can't watch write activity (" << e.what() << "), polling" << endl;
 
 		}
 
 	}
 
-	Udjat::Abstract::Agent::start();
+ }
+
+ void Agent::written() noexcept {
+
+	if(watch.pending.exchange(true)) {
+		return;
+	}
+
+	// Coalesce event storms, no more than one refresh per window.
+	time_t now = time(nullptr);
+	time_t next = watch.sampled + watch.window;
+	requestRefresh(next > now ? next - now : 0);
 
  }
 
  void Agent::setup() {
 
+#ifdef HAVE_INSTRUMENTATION
+	Udjat::Instrumentation::insert(getMountPoint(),instrumentation);
+#endif // HAVE_INSTRUMENTATION
+
+	available = make_shared<Available>();
+	inodes = make_shared<Inodes>();
+	growth = make_shared<Growth>();
+	forecast = make_shared<Forecast>();
+
+	Udjat::Abstract::Agent::push_back(available);
+	Udjat::Abstract::Agent::push_back(inodes);
+	Udjat::Abstract::Agent::push_back(growth);
+	Udjat::Abstract::Agent::push_back(forecast);
+
 	for(size_t ix = 0; ix < (sizeof(sysdefs)/sizeof(sysdefs[0])); ix++) {
 
-		if(!strcasecmp(mount_point,sysdefs[ix].mp)) {
+		if(!strcasecmp(getMountPoint(),sysdefs[ix].mp)) {
 
 			// Have sysdef, update agent information.
 			this->Object::properties.icon = sysdefs[ix].icon;
@@ -356,10 +819,237 @@
  }
 
  bool Agent::refresh() {
- 	set(Udjat::FileSystem(mount_point).used() * 100);
+
+#ifdef HAVE_INSTRUMENTATION
+	uint64_t started = Udjat::Instrumentation::now();
+
+	try {
+
+		bool rc = sample();
+		instrumentation.latency.push(Udjat::Instrumentation::now() - started);
+		return rc;
+
+	} catch(...) {
+
+		instrumentation.errors++;
+		throw;
+
+	}
+#else
+	return sample();
+#endif // HAVE_INSTRUMENTATION
+
+ }
+
+ Agent::Snapshot Agent::getSnapshot() const {
+	std::lock_guard<std::mutex> lock(guard);
+	return Snapshot{stats,used};
+ }
+
+ size_t Agent::memory() const noexcept {
+
+	size_t bytes =
+		sizeof(*this) + sizeof(Metadata) + sizeof(Available) + sizeof(Growth) + sizeof(Forecast)
+		+ inodes->memory()
+		+ (states.size() * sizeof(Udjat::State<float>))
+		+ (texts.capacity() * sizeof(Udjat::Atom))
+		+ (boundaries.capacity() * sizeof(float));
+
+	for(const Udjat::Atom *atom : { &disk->mount_point, &disk->name, &disk->device, &disk->type, &disk->label }) {
+		bytes += atom->size() + 1;
+	}
+
+	for(const auto &text : texts) {
+		bytes += text.size() + 1;
+	}
+
+	if(unresponsive) {
+		bytes += sizeof(Udjat::Abstract::State);
+	}
+
+	if(filesystem) {
+		bytes += sizeof(Udjat::FileSystem);
+	}
+
+	if(activity) {
+		bytes += sizeof(Udjat::Activity);
+	}
+
+	if(latency) {
+		bytes += sizeof(Latency);
+	}
+
+	return bytes;
+
+ }
+
+ void Agent::get(const Udjat::Request &request, Udjat::Response &response) {
+
+	super::get(request,response);
+
+	response["memory"] = (unsigned long long) memory();
+
+#ifdef HAVE_INSTRUMENTATION
+	instrumentation.get(response["instrumentation"]);
+#endif // HAVE_INSTRUMENTATION
+
+ }
+
+ bool Agent::sample() {
+
+	if(!filesystem) {
+		filesystem.reset(new Udjat::FileSystem(getMountPoint(),timeout));
+	}
+
+	watch.sampled = time(nullptr);
+	watch.pending = false;
+
+	// One sample per refresh, shared with the child agents.
+	Udjat::FileSystem::Stats current;
+	try {
+
+		current = filesystem->stats();
+
+	} catch(const Udjat::FileSystem::Timeout &e) {
+
+		if(!unresponsive) {
+			texts.emplace_back(expand(_( "${name} is not responding" )));
+			unresponsive = make_shared<Udjat::Abstract::State>(
+				"unresponsive",
+				Udjat::error,
+				texts.back().c_str()
+			);
+			error() << e.what() << endl;
+			activate(unresponsive);
+			changed();
+		}
+
+#ifdef HAVE_INSTRUMENTATION
+		instrumentation.timeouts++;
+#endif // HAVE_INSTRUMENTATION
+
+		return false;
+
+	}
+
+#ifdef HAVE_INSTRUMENTATION
+	instrumentation.last = Udjat::Instrumentation::now();
+#endif // HAVE_INSTRUMENTATION
+
+	if(unresponsive) {
+		info() << "Mount point is responding again" << endl;
+		unresponsive.reset();
+		activate(stateFromValue());
+	}
+
+	{
+		// Published as a whole, the exporters read it from other threads.
+		std::lock_guard<std::mutex> lock(guard);
+		stats = current;
+		used = stats.used() * 100;
+	}
+
+ 	set(used);
+	available->set(stats.available);
+	inodes->set(stats.iused() * 100);
+
+	// Update history and forecast.
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		history.push(((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0), super::get());
+
+		growth->set((float) (history.rate() * 3600));
+
+		double seconds = history.eta(100);
+		forecast->set(seconds < 0 ? std::numeric_limits<float>::infinity() : (float) (seconds / 3600));
+	}
+
+	reschedule();
+	changed();
+
  	return true;
  }
 
+ void Agent::setRevision(std::shared_ptr<Revision> r) noexcept {
+	revision = r;
+ }
+
+ void Agent::changed() noexcept {
+
+	const Udjat::Abstract::State *current = state().get();
+	long used = std::lround(super::get() * 100);
+	long rate = std::lround(history.rate() * 360000);
+
+	double seconds = history.eta(100);
+	long ttf = (seconds < 0 ? -1 : (long) (seconds / 60));
+
+	if(current != exported.state || used != exported.used || rate != exported.rate || ttf != exported.ttf) {
+		exported.state = current;
+		exported.used = used;
+		exported.rate = rate;
+		exported.ttf = ttf;
+		if(revision) {
+			(*revision)++;
+		}
+	}
+
+ }
+
+ std::shared_ptr<Udjat::Abstract::State> Agent::stateFromValue() const {
+	if(unresponsive) {
+		return unresponsive;
+	}
+	return super::stateFromValue();
+ }
+
+ void Agent::reschedule() {
+
+	if(activity) {
+		// Driven by write activity, the timer just keeps the history alive.
+		update.timer = 3600;
+		return;
+	}
+
+	if(!interval.max) {
+		return;
+	}
+
+	if(history.size() < 2) {
+		update.timer = (interval.min ? interval.min : 1);
+		return;
+	}
+
+	double value = super::get();
+	double rate = history.rate();	// %/second
+
+	// Distance to the next state boundary in the direction of change.
+	double distance = 100;
+	for(float boundary : boundaries) {
+		if(rate >= 0 && boundary > value) {
+			distance = std::min(distance, boundary - value);
+		}
+		if(rate <= 0 && boundary < value) {
+			distance = std::min(distance, value - boundary);
+		}
+	}
+
+	// Near a boundary poll faster, whatever the rate is: from the min interval at 1%
+	// (or less) from it up to the max interval at 10%.
+	double seconds = ((double) interval.min) + (((double) (interval.max - interval.min)) * std::min(1.0, std::max(0.0, (distance - 1) / 9)));
+
+	// Take at least 4 samples before crossing the boundary.
+	if(rate != 0) {
+		seconds = std::min(seconds, distance / std::fabs(rate) / 4);
+	}
+
+	seconds = std::max(seconds, (double) interval.min);
+	seconds = std::min(seconds, (double) interval.max);
+
+	update.timer = (unsigned short) (seconds < 1 ? 1 : seconds);
+
+ }
+
  std::string Agent::to_string() const noexcept {
 
 	// https://stackoverflow.com/questions/14432043/float-formatting-in-c
@@ -370,5 +1060,11 @@
  }
 
  Agent::~Agent() {
+	if(activity) {
+		Udjat::MainLoop::getInstance().remove(this);
+	}
+#ifdef HAVE_INSTRUMENTATION
+	Udjat::Instrumentation::remove(instrumentation);
+#endif // HAVE_INSTRUMENTATION
  }
 
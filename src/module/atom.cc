@@ -0,0 +1,158 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/atom.h>
+ #include <atomic>
+ #include <mutex>
+ #include <string_view>
+ #include <unordered_map>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	struct Atom::Entry {
+
+		/// @brief References; the last one is always dropped with the pool locked.
+		std::atomic<size_t> references{1};
+
+		std::string value;
+
+		Entry(const char *str) : value(str) {
+		}
+
+	};
+
+	/// @brief Interned strings, indexed by a view of their own buffers.
+	struct Atom::Pool {
+		std::mutex guard;
+		std::unordered_map<std::string_view,Entry *> entries;
+		size_t bytes = 0;		///< @brief String buffers.
+	};
+
+	Atom::Pool & Atom::pool() {
+		static Pool instance;
+		return instance;
+	}
+
+	Atom::Atom(const char *str) {
+
+		if(!(str && *str)) {
+			return;
+		}
+
+		Pool &strings = pool();
+		std::lock_guard<std::mutex> lock(strings.guard);
+
+		auto it = strings.entries.find(std::string_view{str});
+		if(it != strings.entries.end()) {
+			// References only grow from zero with the pool locked, see release().
+			it->second->references++;
+			entry = it->second;
+			return;
+		}
+
+		entry = new Entry(str);
+		strings.entries.emplace(std::string_view{entry->value},entry);
+		strings.bytes += entry->value.capacity() + 1;
+
+	}
+
+	Atom::Atom(const Atom &src) noexcept : entry(src.entry) {
+		if(entry) {
+			entry->references++;
+		}
+	}
+
+	Atom & Atom::operator=(const Atom &src) noexcept {
+		if(src.entry != entry) {
+			if(src.entry) {
+				src.entry->references++;
+			}
+			release();
+			entry = src.entry;
+		}
+		return *this;
+	}
+
+	Atom & Atom::operator=(Atom &&src) noexcept {
+		if(&src != this) {
+			release();
+			entry = src.entry;
+			src.entry = nullptr;
+		}
+		return *this;
+	}
+
+	void Atom::release() noexcept {
+
+		if(!entry) {
+			return;
+		}
+
+		// Not the last reference, no need to lock.
+		size_t references = entry->references.load();
+		while(references > 1) {
+			if(entry->references.compare_exchange_weak(references,references-1)) {
+				entry = nullptr;
+				return;
+			}
+		}
+
+		// Maybe the last one, check again with the pool locked (a lookup can revive it).
+		{
+			Pool &strings = pool();
+			std::lock_guard<std::mutex> lock(strings.guard);
+
+			if(--entry->references == 0) {
+				strings.entries.erase(std::string_view{entry->value});
+				strings.bytes -= entry->value.capacity() + 1;
+				delete entry;
+			}
+		}
+
+		entry = nullptr;
+
+	}
+
+	const char * Atom::c_str() const noexcept {
+		return entry ? entry->value.c_str() : "";
+	}
+
+	size_t Atom::size() const noexcept {
+		return entry ? entry->value.size() : 0;
+	}
+
+	size_t Atom::count() noexcept {
+		Pool &strings = pool();
+		std::lock_guard<std::mutex> lock(strings.guard);
+		return strings.entries.size();
+	}
+
+	size_t Atom::bytes() noexcept {
+		Pool &strings = pool();
+		std::lock_guard<std::mutex> lock(strings.guard);
+		return strings.bytes
+				+ (strings.entries.size() * (sizeof(Entry) + sizeof(std::string_view) + sizeof(Entry *) + (2 * sizeof(void *))))
+				+ (strings.entries.bucket_count() * sizeof(void *));
+	}
+
+ }
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/backend.h>
+ #include <udjat/instrumentation.h>
+ #include <system_error>
+ #include <mutex>
+ #include <fcntl.h>
+ #include <unistd.h>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	static std::mutex guard;
+	static std::shared_ptr<Backend> active;
+
+	Backend::~Backend() {
+	}
+
+	Backend & Backend::getInstance() {
+		std::lock_guard<std::mutex> lock(guard);
+		if(!active) {
+			active = make_shared<Backend>();
+		}
+		return *active;
+	}
+
+	void Backend::set(std::shared_ptr<Backend> backend) {
+		// The previous backend is kept alive, pending samples can still be using it.
+		static std::vector<std::shared_ptr<Backend>> retired;
+		std::lock_guard<std::mutex> lock(guard);
+		if(active) {
+			retired.push_back(active);
+		}
+		active = backend;
+	}
+
+	void Backend::discover(std::vector<BlockDevice> &devices, bool probe) {
+		if(probe) {
+			BlockDevice::probe(devices);
+		} else {
+			BlockDevice::discover(devices);
+		}
+	}
+
+	void Backend::mountinfo(MountInfo &mounts, int fd) {
+
+#ifdef HAVE_INSTRUMENTATION
+		Instrumentation::syscalls().mountinfo++;
+#endif // HAVE_INSTRUMENTATION
+
+		if(fd >= 0) {
+			mounts.load(fd);
+		} else {
+			mounts = MountInfo("/proc/self/mountinfo");
+		}
+	}
+
+	void Backend::diskstats(std::string &text) {
+
+#ifdef HAVE_INSTRUMENTATION
+		Instrumentation::syscalls().diskstats++;
+#endif // HAVE_INSTRUMENTATION
+
+		int fd = open("/proc/diskstats",O_RDONLY|O_CLOEXEC);
+		if(fd < 0) {
+			throw system_error(errno,system_category(),"/proc/diskstats");
+		}
+
+		// Reuse buffer, it stays the same size between reads.
+		text.clear();
+		char buffer[4096];
+		ssize_t bytes;
+		while((bytes = read(fd,buffer,sizeof(buffer))) > 0) {
+			text.append(buffer,bytes);
+		}
+		::close(fd);
+
+		if(bytes < 0) {
+			throw system_error(errno,system_category(),"/proc/diskstats");
+		}
+
+	}
+
+	int Backend::stats(const char UDJAT_UNUSED(*mount_point), FileSystem::Stats &stats, const std::function<int(FileSystem::Stats &stats)> &sample) {
+		return sample(stats);
+	}
+
+ }
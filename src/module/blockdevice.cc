@@ -0,0 +1,241 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/blockdevice.h>
+ #include <blkid/blkid.h>
+ #include <sys/sysmacros.h>
+ #include <dirent.h>
+ #include <cstdio>
+ #include <cstring>
+ #include <cstdlib>
+ #include <cctype>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	/// @brief Read the first line of a small sysfs attribute.
+	static bool readline(const string &filename, string &value) {
+
+		FILE *fp = fopen(filename.c_str(),"re");
+		if(!fp) {
+			return false;
+		}
+
+		char buffer[256];
+		bool rc = (fgets(buffer,sizeof(buffer),fp) != NULL);
+		fclose(fp);
+
+		if(rc) {
+			buffer[strcspn(buffer,"\r\n")] = 0;
+			value = buffer;
+		}
+
+		return rc;
+	}
+
+	/// @brief Decode udev '\x20' encoded strings (ID_FS_LABEL_ENC).
+	static string decode(const char *str) {
+
+		string value;
+
+		while(*str) {
+			if(str[0] == '\\' && str[1] == 'x' && isxdigit(str[2]) && isxdigit(str[3])) {
+				char hex[3] = { str[2], str[3], 0 };
+				value += (char) strtoul(hex,NULL,16);
+				str += 4;
+			} else {
+				value += *(str++);
+			}
+		}
+
+		return value;
+	}
+
+	/// @brief Get LABEL and TYPE from blkid tags.
+	static void gettags(blkid_dev dev, string &label, string &type) {
+
+		blkid_tag_iterate tag = blkid_tag_iterate_begin(dev);
+		const char *t, *value;
+		while (blkid_tag_next(tag, &t, &value) == 0) {
+
+			if(!strcasecmp(t,"LABEL")) {
+				label = value;
+			} else if(!strcasecmp(t,"TYPE")) {
+				type = value;
+			}
+
+		}
+		blkid_tag_iterate_end(tag);
+
+	}
+
+	void BlockDevice::probe(std::vector<BlockDevice> &devices) {
+
+		blkid_cache cache = NULL;
+
+		blkid_get_cache(&cache,NULL);
+		blkid_probe_all(cache);
+		blkid_dev_iterate iter = blkid_dev_iterate_begin(cache);
+		blkid_dev dev;
+		while (blkid_dev_next(iter, &dev) == 0) {
+
+			dev = blkid_verify(cache, dev);
+			if (!dev)
+				continue;
+
+			string label;
+			string type;
+
+			gettags(dev,label,type);
+			devices.emplace_back(blkid_dev_devname(dev),label,type);
+
+		}
+
+		blkid_dev_iterate_end(iter);
+
+		blkid_put_cache(cache);
+
+	}
+
+	void BlockDevice::discover(std::vector<BlockDevice> &devices) {
+
+		DIR *dir = opendir("/sys/class/block");
+		if(!dir) {
+			// No sysfs, probe all devices.
+			probe(devices);
+			return;
+		}
+
+		blkid_cache cache = NULL;
+
+		struct dirent *entry;
+		while((entry = readdir(dir)) != NULL) {
+
+			if(entry->d_name[0] == '.') {
+				continue;
+			}
+
+			string path{"/sys/class/block/"};
+			path += entry->d_name;
+
+			string value;
+
+			// Ignore empty devices (unused loop devices, empty card readers, ...)
+			if(!readline(path + "/size",value) || strtoull(value.c_str(),NULL,10) == 0) {
+				continue;
+			}
+
+			unsigned int major = 0, minor = 0;
+			if(!readline(path + "/dev",value) || sscanf(value.c_str(),"%u:%u",&major,&minor) != 2) {
+				continue;
+			}
+
+			string devname{"/dev/"};
+			devname += entry->d_name;
+
+			string label, type, dmname;
+			bool udev = false;
+
+			{
+				char filename[64];
+				snprintf(filename,sizeof(filename),"/run/udev/data/b%u:%u",major,minor);
+
+				FILE *fp = fopen(filename,"re");
+				if(fp) {
+
+					udev = true;
+
+					char line[1024];
+					string encoded;
+					while(fgets(line,sizeof(line),fp)) {
+
+						line[strcspn(line,"\r\n")] = 0;
+
+						if(strncmp(line,"E:",2)) {
+							continue;
+						}
+
+						const char *name = line+2;
+						const char *eq = strchr(name,'=');
+						if(!eq) {
+							continue;
+						}
+
+						size_t szname = eq-name;
+						if(szname == 11 && !strncmp(name,"ID_FS_LABEL",szname)) {
+							label = eq+1;
+						} else if(szname == 15 && !strncmp(name,"ID_FS_LABEL_ENC",szname)) {
+							encoded = eq+1;
+						} else if(szname == 10 && !strncmp(name,"ID_FS_TYPE",szname)) {
+							type = eq+1;
+						} else if(szname == 7 && !strncmp(name,"DM_NAME",szname)) {
+							dmname = eq+1;
+						}
+
+					}
+
+					fclose(fp);
+
+					if(!encoded.empty()) {
+						label = decode(encoded.c_str());
+					}
+
+				}
+			}
+
+			if(!dmname.empty()) {
+				devname = "/dev/mapper/";
+				devname += dmname;
+			}
+
+			if(!udev) {
+
+				// No udev data, probe device.
+				if(!cache) {
+					blkid_get_cache(&cache,NULL);
+				}
+
+				blkid_dev dev = blkid_get_dev(cache,devname.c_str(),BLKID_DEV_NORMAL);
+				if(dev) {
+					gettags(dev,label,type);
+				}
+
+			}
+
+			if(type.empty()) {
+				// No filesystem (partition tables, swap without signature, ...)
+				continue;
+			}
+
+			devices.emplace_back(devname.c_str(),label,type,makedev(major,minor));
+
+		}
+
+		closedir(dir);
+
+		if(cache) {
+			blkid_put_cache(cache);
+		}
+
+	}
+
+ }
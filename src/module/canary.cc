@@ -0,0 +1,311 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/canary.h>
+ #include <system_error>
+ #include <algorithm>
+ #include <atomic>
+ #include <mutex>
+ #include <thread>
+ #include <unordered_map>
+ #include <vector>
+ #include <cstdint>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <cstring>
+ #include <ctime>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/stat.h>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	static double monotonic() noexcept {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+	}
+
+	/// @brief Probe slot of a device, shared by all the canaries on it.
+	struct Slot {
+		bool busy = false;		///< @brief A probe is running.
+		double next = 0;		///< @brief Earliest start of the next probe (rate limit).
+	};
+
+	static std::mutex slots_guard;
+
+	static std::unordered_map<dev_t,Slot> & slots() {
+		static std::unordered_map<dev_t,Slot> instance;
+		return instance;
+	}
+
+	struct Canary::Context {
+
+		Options options;
+
+		/// @brief The canary file.
+		std::string filename;
+
+		/// @brief Device of the canary directory.
+		dev_t dev = 0;
+
+		/// @brief Extra open() flags (O_DIRECT, dropped if the filesystem refuses it).
+		int flags = 0;
+
+		/// @brief Probe buffer, aligned and sized for O_DIRECT.
+		void *buffer = nullptr;
+		size_t length = 0;
+
+		/// @brief Sequence stamped on each probe, to verify the read back.
+		uint64_t sequence = 0;
+
+		mutable std::mutex guard;
+
+		/// @brief Start of the running probe, 0 if idle.
+		double started = 0;
+
+		/// @brief Latency window (in us), ring buffers.
+		std::vector<uint32_t> writes;
+		std::vector<uint32_t> reads;
+		size_t head = 0;
+		size_t count = 0;
+
+		std::atomic<uint64_t> errors{0};
+		std::atomic<uint64_t> skipped{0};
+
+		Context(const Options &o) : options(o), writes(o.window ? o.window : 1), reads(o.window ? o.window : 1) {
+
+			struct stat st;
+			if(stat(options.directory.c_str(),&st)) {
+				throw system_error(errno,system_category(),options.directory);
+			}
+
+			if(!S_ISDIR(st.st_mode)) {
+				throw system_error(ENOTDIR,system_category(),options.directory);
+			}
+
+			dev = st.st_dev;
+			// Unique per canary, several agents (or mounts) may share the directory.
+			char suffix[64];
+			snprintf(suffix,sizeof(suffix),"%d-%lx",(int) getpid(),(unsigned long) (uintptr_t) this);
+			filename = options.directory + "/.udjat-canary-" + suffix;
+
+			if(options.direct) {
+				flags |= O_DIRECT;
+			}
+
+			// O_DIRECT needs block aligned buffers and sizes.
+			length = ((std::max(options.size,(size_t) 1) + 4095) / 4096) * 4096;
+			if(posix_memalign(&buffer,4096,length)) {
+				throw system_error(ENOMEM,system_category(),"Can't allocate canary buffer");
+			}
+
+		}
+
+		~Context() {
+			free(buffer);
+			unlink(filename.c_str());
+		}
+
+		/// @brief Run a probe (on the probing thread).
+		void run() noexcept;
+
+		/// @brief Get percentiles from a window.
+		Percentiles percentiles(const std::vector<uint32_t> &window) const;
+
+	};
+
+	void Canary::Context::run() noexcept {
+
+		uint64_t stamp = ++sequence;
+		uint64_t *words = (uint64_t *) buffer;
+		for(size_t ix = 0; ix < (length / sizeof(uint64_t)); ix++) {
+			words[ix] = stamp;
+		}
+
+		bool ok = false;
+
+		// Write and fsync.
+		double begin = monotonic();
+
+		int fd = open(filename.c_str(),O_WRONLY|O_CREAT|O_CLOEXEC|flags,0600);
+		if(fd < 0 && (flags & O_DIRECT) && errno == EINVAL) {
+			// No O_DIRECT on this filesystem (tmpfs), the read back will bypass the cache with fadvise.
+			flags &= ~O_DIRECT;
+			fd = open(filename.c_str(),O_WRONLY|O_CREAT|O_CLOEXEC,0600);
+		}
+
+		if(fd >= 0) {
+			ok = (pwrite(fd,buffer,length,0) == (ssize_t) length && fsync(fd) == 0);
+			::close(fd);
+		}
+
+		double written = monotonic();
+		double reading = written;
+		double finished = written;
+
+		// Read back from the device.
+		if(ok) {
+
+			ok = false;
+			memset(buffer,0,length);
+
+			fd = open(filename.c_str(),O_RDONLY|O_CLOEXEC|flags);
+			if(fd >= 0) {
+
+				if(!(flags & O_DIRECT)) {
+					// The pages are clean after fsync, drop them so the read hits the device.
+					posix_fadvise(fd,0,0,POSIX_FADV_DONTNEED);
+				}
+
+				reading = monotonic();
+
+				if(pread(fd,buffer,length,0) == (ssize_t) length) {
+					ok = true;
+					for(size_t ix = 0; ok && ix < (length / sizeof(uint64_t)); ix++) {
+						ok = (words[ix] == stamp);
+					}
+				}
+
+				finished = monotonic();
+				::close(fd);
+
+			}
+
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(guard);
+
+			if(ok) {
+				writes[head] = (uint32_t) std::min((written - begin) * 1000000, 4294967295.0);
+				reads[head] = (uint32_t) std::min((finished - reading) * 1000000, 4294967295.0);
+				head = (head + 1) % writes.size();
+				if(count < writes.size()) {
+					count++;
+				}
+			} else {
+				errors++;
+			}
+
+			started = 0;
+		}
+
+		// Release the device, keeping the canary below the rate limit.
+		{
+			std::lock_guard<std::mutex> lock(slots_guard);
+			Slot &slot = slots()[dev];
+			slot.busy = false;
+			if(options.rate) {
+				slot.next = finished + (((double) (length * 2)) / (((double) options.rate) * 1024));
+			}
+		}
+
+	}
+
+	Canary::Percentiles Canary::Context::percentiles(const std::vector<uint32_t> &window) const {
+
+		Percentiles result;
+
+		std::vector<uint32_t> values;
+		{
+			std::lock_guard<std::mutex> lock(guard);
+			values.assign(window.begin(),window.begin() + count);
+		}
+
+		result.samples = values.size();
+		if(values.empty()) {
+			return result;
+		}
+
+		auto percentile = [&values](size_t p) {
+			auto it = values.begin() + (((values.size() - 1) * p) / 100);
+			std::nth_element(values.begin(),it,values.end());
+			return *it;
+		};
+
+		result.p50 = percentile(50);
+		result.p90 = percentile(90);
+		result.p99 = percentile(99);
+
+		return result;
+
+	}
+
+	Canary::Canary(const Options &options) : context(make_shared<Context>(options)) {
+	}
+
+	Canary::~Canary() {
+		// A running probe keeps the context (and the file) until it finishes.
+	}
+
+	bool Canary::probe() {
+
+		double now = monotonic();
+
+		{
+			std::lock_guard<std::mutex> lock(slots_guard);
+			Slot &slot = slots()[context->dev];
+			if(slot.busy || now < slot.next) {
+				context->skipped++;
+				return false;
+			}
+			slot.busy = true;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(context->guard);
+			context->started = now;
+		}
+
+		std::shared_ptr<Context> ctx{context};
+		std::thread([ctx](){
+			ctx->run();
+		}).detach();
+
+		return true;
+
+	}
+
+	double Canary::pending() const noexcept {
+		std::lock_guard<std::mutex> lock(context->guard);
+		return context->started ? monotonic() - context->started : 0;
+	}
+
+	Canary::Percentiles Canary::write() const {
+		return context->percentiles(context->writes);
+	}
+
+	Canary::Percentiles Canary::read() const {
+		return context->percentiles(context->reads);
+	}
+
+	uint64_t Canary::errors() const noexcept {
+		return context->errors;
+	}
+
+	uint64_t Canary::skipped() const noexcept {
+		return context->skipped;
+	}
+
+ }
@@ -0,0 +1,410 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <cgroups.h>
+ #include <udjat/atom.h>
+ #include <udjat/tools/intl.h>
+ #include <udjat/tools/logger.h>
+ #include <udjat/tools/mainloop.h>
+ #include <system_error>
+ #include <sstream>
+ #include <iomanip>
+ #include <vector>
+ #include <cstring>
+ #include <ctime>
+ #include <dirent.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/inotify.h>
+ #include <sys/sysmacros.h>
+
+ using namespace std;
+
+ class CGroups::Group : public Udjat::Agent<float> {
+ private:
+
+	const CGroups &owner;
+
+	/// @brief Agent name and label, released when the cgroup goes away.
+	Udjat::Atom id;
+	Udjat::Atom label;
+
+	/// @brief Path relative to the subtree root.
+	std::string relative;
+
+	/// @brief Path of io.stat.
+	std::string filename;
+
+	struct Device {
+		dev_t dev;
+		Udjat::IOStat::Counters counters;
+		float read = 0;		///< @brief Bytes read per second.
+		float write = 0;	///< @brief Bytes written per second.
+		float rios = 0;		///< @brief Reads per second.
+		float wios = 0;		///< @brief Writes per second.
+	};
+
+	std::vector<Device> devices;
+
+	/// @brief Guards 'devices', exported from the HTTP thread while refresh() updates it.
+	mutable std::mutex guard;
+
+	/// @brief Time of the last sample.
+	double timestamp = 0;
+
+ public:
+	Group(const CGroups &o, const std::string &r, const Udjat::Atom &name)
+		: Udjat::Agent<float>(name.c_str()), owner(o), id(name), label(r), relative(r), filename(o.root + "/" + r + "/io.stat") {
+		Object::properties.icon = "utilities-system-monitor";
+		Object::properties.label = label.c_str();
+		update.timer = owner.interval;
+	}
+
+	inline const std::string & path() const noexcept {
+		return relative;
+	}
+
+	bool refresh() override {
+
+		int fd = open(filename.c_str(),O_RDONLY|O_CLOEXEC);
+		if(fd < 0) {
+			// Removed, the inotify handler will drop the agent.
+			return false;
+		}
+
+		char text[4096];
+		ssize_t length = read(fd,text,sizeof(text)-1);
+		::close(fd);
+
+		if(length < 0) {
+			throw system_error(errno,system_category(),filename);
+		}
+		text[length] = 0;
+
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		double now = ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+		double elapsed = now - timestamp;
+
+		float total = 0;
+
+		std::lock_guard<std::mutex> lock(guard);
+
+		Udjat::IOStat::parse(text,[this,elapsed,&total](dev_t dev, const Udjat::IOStat::Counters &counters){
+
+			Device *device = nullptr;
+			for(auto &item : devices) {
+				if(item.dev == dev) {
+					device = &item;
+					break;
+				}
+			}
+
+			if(!device) {
+				devices.push_back(Device{dev,counters});
+				return;
+			}
+
+			if(timestamp && counters.rbytes >= device->counters.rbytes && counters.wbytes >= device->counters.wbytes) {
+				device->read = (float) ((counters.rbytes - device->counters.rbytes) / elapsed);
+				device->write = (float) ((counters.wbytes - device->counters.wbytes) / elapsed);
+				device->rios = (float) ((counters.rios - device->counters.rios) / elapsed);
+				device->wios = (float) ((counters.wios - device->counters.wios) / elapsed);
+				total += device->read + device->write;
+			}
+
+			device->counters = counters;
+
+		});
+
+		timestamp = now;
+		set(total);
+		return true;
+
+	}
+
+	void report(Udjat::Value &value) const {
+
+		value["name"] = relative;
+		value["throughput"] = Udjat::Agent<float>::get();
+
+		// Copy, the mount points are looked up without the lock.
+		std::vector<Device> current;
+		{
+			std::lock_guard<std::mutex> lock(guard);
+			current = devices;
+		}
+
+		Udjat::Value &list = value["devices"];
+		for(const auto &device : current) {
+			Udjat::Value &item = list.append(Udjat::Value::Object);
+
+			char dev[32];
+			snprintf(dev,sizeof(dev),"%u:%u",major(device.dev),minor(device.dev));
+			item["device"] = dev;
+			item["mp"] = owner.mountpoints(device.dev);
+			item["read"] = device.read;
+			item["write"] = device.write;
+			item["rios"] = device.rios;
+			item["wios"] = device.wios;
+		}
+
+	}
+
+	void get(const Udjat::Request &request, Udjat::Response &response) override {
+		Udjat::Agent<float>::get(request,response);
+		report(response);
+	}
+
+	std::string to_string() const noexcept override {
+
+		static const char *units[] = { "B/s", "KB/s", "MB/s", "GB/s" };
+
+		double value = Udjat::Agent<float>::get();
+		size_t ix = 0;
+		while(value >= 1024.0 && ix < ((sizeof(units)/sizeof(units[0]))-1)) {
+			value /= 1024.0;
+			ix++;
+		}
+
+		std::stringstream out;
+		out << std::fixed << std::setprecision(2) << value << " " << units[ix];
+		return out.str();
+
+	}
+
+ };
+
+ CGroups::CGroups(const char *subtree, const pugi::xml_node &node) : Udjat::Abstract::Agent("cgroups") {
+
+	Object::properties.icon = "utilities-system-monitor";
+	Object::properties.label = _( "Control groups I/O" );
+
+	root = subtree;
+	if(root.find('/') != 0) {
+		root.insert(0,"/sys/fs/cgroup/");
+	}
+	while(root.size() > 1 && root.back() == '/') {
+		root.pop_back();
+	}
+
+	depth = (unsigned short) node.attribute("cgroups-depth").as_uint(depth);
+	interval = (unsigned short) node.attribute("cgroups-timer").as_uint(interval);
+
+ }
+
+ CGroups::~CGroups() {
+	if(inotify >= 0) {
+		Udjat::MainLoop::getInstance().remove(this);
+		::close(inotify);
+	}
+ }
+
+ void CGroups::set(const Udjat::MountInfo &mounts) {
+
+	std::unordered_map<dev_t,std::string> map;
+
+	for(const auto &entry : mounts) {
+		if(!entry.device) {
+			continue;
+		}
+		std::string &mp = map[Udjat::IOStat::disk(entry.device)];
+		if(!mp.empty()) {
+			mp += ",";
+		}
+		mp += entry.mount_point;
+	}
+
+	std::lock_guard<std::mutex> lock(guard);
+	devices = std::move(map);
+
+ }
+
+ std::string CGroups::mountpoints(dev_t disk) const {
+	std::lock_guard<std::mutex> lock(guard);
+	auto it = devices.find(disk);
+	return it == devices.end() ? std::string{} : it->second;
+ }
+
+ void CGroups::start() {
+
+	Udjat::Abstract::Agent::start();
+
+	if(inotify >= 0) {
+		return;
+	}
+
+	inotify = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+	if(inotify < 0) {
+		warning() << "Can't watch " << root << " (" << strerror(errno) << "), new cgroups will be ignored" << endl;
+	} else {
+		Udjat::MainLoop::getInstance().insert(this,inotify,Udjat::MainLoop::oninput,[this](const Udjat::MainLoop::Event) {
+			changed();
+			return true;
+		});
+	}
+
+	scan("",0);
+
+ }
+
+ void CGroups::scan(const std::string &relative, unsigned short level) {
+
+	std::string path{root};
+	if(!relative.empty()) {
+		path += "/";
+		path += relative;
+	}
+
+	if(level) {
+
+		// Agent name from the relative path, the separators would break the agent path.
+		std::string name{relative};
+		for(char &c : name) {
+			if(c == '/') {
+				c = '.';
+			}
+		}
+
+		auto group = make_shared<Group>(*this,relative,Udjat::Atom{name});
+		{
+			std::lock_guard<std::mutex> lock(guard);
+			Udjat::Abstract::Agent::push_back(group);
+		}
+		group->start();
+
+	}
+
+	if(level >= depth) {
+		return;
+	}
+
+	// Watch before listing, so a cgroup created in between isn't lost.
+	if(inotify >= 0) {
+		int wd = inotify_add_watch(inotify,path.c_str(),IN_CREATE|IN_DELETE|IN_ONLYDIR);
+		if(wd >= 0) {
+			watches[wd] = relative;
+		}
+	}
+
+	DIR *dir = opendir(path.c_str());
+	if(!dir) {
+		warning() << "Can't read " << path << ": " << strerror(errno) << endl;
+		return;
+	}
+
+	struct dirent *entry;
+	while((entry = readdir(dir)) != NULL) {
+		if(entry->d_type != DT_DIR || entry->d_name[0] == '.') {
+			continue;
+		}
+		scan(relative.empty() ? std::string{entry->d_name} : (relative + "/" + entry->d_name),level+1);
+	}
+
+	closedir(dir);
+
+ }
+
+ void CGroups::remove(const std::string &relative) {
+
+	std::vector<std::shared_ptr<Udjat::Abstract::Agent>> removed;
+	std::string prefix{relative + "/"};
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	for(auto child : *this) {
+		auto group = dynamic_cast<Group *>(child.get());
+		if(group && (group->path() == relative || group->path().compare(0,prefix.size(),prefix) == 0)) {
+			removed.push_back(child);
+		}
+	}
+
+	for(auto child : removed) {
+		Udjat::Abstract::Agent::remove(child);
+	}
+
+ }
+
+ void CGroups::changed() {
+
+	alignas(struct inotify_event) char buffer[4096];
+	ssize_t length;
+
+	while((length = read(inotify,buffer,sizeof(buffer))) > 0) {
+
+		for(ssize_t offset = 0; offset < length;) {
+
+			const struct inotify_event *event = (const struct inotify_event *) (buffer + offset);
+			offset += sizeof(struct inotify_event) + event->len;
+
+			if(event->mask & IN_IGNORED) {
+				watches.erase(event->wd);
+				continue;
+			}
+
+			auto watch = watches.find(event->wd);
+			if(watch == watches.end() || !event->len || !(event->mask & IN_ISDIR)) {
+				continue;
+			}
+
+			std::string relative{watch->second.empty() ? std::string{event->name} : (watch->second + "/" + event->name)};
+			unsigned short level = 1;
+			for(char c : relative) {
+				if(c == '/') {
+					level++;
+				}
+			}
+
+			if(event->mask & IN_CREATE) {
+				info() << "cgroup '" << relative << "' was created" << endl;
+				scan(relative,level);
+			} else if(event->mask & IN_DELETE) {
+				info() << "cgroup '" << relative << "' was removed" << endl;
+				remove(relative);
+			}
+
+		}
+
+	}
+
+ }
+
+ void CGroups::report(Udjat::Value &value) {
+
+	// Copy the children under the guard, changed() adds and removes them on the main loop;
+	// the groups are reported without it (they take it to get the mount points).
+	std::vector<std::shared_ptr<Udjat::Abstract::Agent>> children;
+	{
+		std::lock_guard<std::mutex> lock(guard);
+		for(auto child : *this) {
+			children.push_back(child);
+		}
+	}
+
+	for(auto &child : children) {
+		auto group = dynamic_cast<Group *>(child.get());
+		if(group) {
+			group->report(value.append(Udjat::Value::Object));
+		}
+	}
+
+ }
+
@@ -0,0 +1,678 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <container.h>
+ #include <io.h>
+ #include <files.h>
+ #include <blkid/blkid.h>
+ #include <udjat/filesystem.h>
+ #include <udjat/tools/mainloop.h>
+ #include <udjat/tools/quark.h>
+ #include <udjat/tools/xml.h>
+ #include <udjat/tools/intl.h>
+ #include <udjat/tools/logger.h>
+ #include <udjat/blockdevice.h>
+ #include <udjat/backend.h>
+ #include <vector>
+ #include <chrono>
+ #include <cstdlib>
+ #include <cstdio>
+ #include <ctime>
+ #include <cmath>
+ #include <fcntl.h>
+ #include <sys/stat.h>
+ #include <poll.h>
+ #include <unistd.h>
+
+ using namespace std;
+
+ /// @brief Append value as a quoted JSON string.
+ static void escape(std::string &json, const std::string &value) {
+
+	json += '"';
+
+	for(unsigned char chr : value) {
+		switch(chr) {
+		case '"':
+			json += "\\\"";
+			break;
+
+		case '\\':
+			json += "\\\\";
+			break;
+
+		default:
+			if(chr < 0x20) {
+				char buffer[8];
+				snprintf(buffer,sizeof(buffer),"\\u%04x",(unsigned int) chr);
+				json += buffer;
+			} else {
+				json += (char) chr;
+			}
+		}
+	}
+
+	json += '"';
+
+ }
+
+ Container::Container(const pugi::xml_node &node) : Udjat::Abstract::Agent("storage") {
+
+	Object::properties.icon = "drive-multidisk";
+	Object::properties.label = _( "Logical disks" );
+
+	//
+	// Data source: record or replay traces for testing (see Udjat::Backend).
+	//
+	{
+		const char *filename = node.attribute("replay").as_string();
+		if(*filename) {
+			warning() << "Replaying '" << filename << "', the values are not from this host" << endl;
+			Udjat::Backend::set(make_shared<Udjat::Backend::Replay>(filename,node.attribute("replay-speed").as_float(0)));
+		} else {
+			filename = node.attribute("record").as_string();
+			if(*filename) {
+				info() << "Recording samples to '" << filename << "'" << endl;
+				Udjat::Backend::set(make_shared<Udjat::Backend::Recorder>(filename));
+			}
+		}
+	}
+
+	iostats = node.attribute("io-stats").as_bool(false);
+	topfiles = node.attribute("top-files").as_uint(0);
+	tracked = node.attribute("top-files-tracked").as_uint((topfiles * 64) + 1024);
+
+	{
+		size_t count = node.attribute("top-processes").as_uint(0);
+		if(count) {
+			processes = make_shared<ProcessAgent>(count,(unsigned short) node.attribute("top-processes-timer").as_uint(10));
+			Udjat::Abstract::Agent::push_back(processes);
+		}
+	}
+	interval = ::Agent::Interval(node);
+	timeout = node.attribute("sample-timeout").as_uint(timeout);
+	canary = ::Agent::Canary(node);
+
+	if(node.attribute("watch-writes").as_bool(false)) {
+		watch = (unsigned short) node.attribute("watch-window").as_uint(5);
+	}
+
+	if(node.attribute("openmetrics").as_bool(false)) {
+		metrics = make_shared<OpenMetrics>();
+	}
+
+	// Get ignore-[type] attributes.
+	for(auto attribute : node.attributes()) {
+		if(!strncasecmp(attribute.name(),"ignore-",7) && attribute.as_bool(false)) {
+			ignored.insert(attribute.name()+7);
+		}
+	}
+
+	//
+	// Get block devices with labels.
+	//
+	struct Device : public Udjat::BlockDevice {
+		Udjat::Atom mountpoint;		///< @brief Interned, shared with the agent.
+
+		Device(const Udjat::BlockDevice &device) : Udjat::BlockDevice(device) {
+		}
+
+	};
+
+#ifdef HAVE_INSTRUMENTATION
+	uint64_t phase = Udjat::Instrumentation::now();
+#endif // HAVE_INSTRUMENTATION
+
+	std::vector<Device> devices;
+	{
+		auto started = std::chrono::steady_clock::now();
+
+		std::vector<Udjat::BlockDevice> detected;
+		Udjat::Backend::getInstance().discover(detected,!strcasecmp(node.attribute("discovery").as_string("udev"),"blkid"));
+		devices.assign(detected.begin(),detected.end());
+
+		info()	<< devices.size() << " block device(s) detected in "
+				<< std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count()
+				<< "ms" << endl;
+
+		for(auto &device : devices) {
+			if(!device.label.empty()) {
+				info() << "Detected device '" << device.devname << "' with name '" << device.label << "'" << endl;
+			}
+		}
+	}
+
+#ifdef HAVE_INSTRUMENTATION
+	timings.discovery = Udjat::Instrumentation::now() - phase;
+	phase = Udjat::Instrumentation::now();
+#endif // HAVE_INSTRUMENTATION
+
+	//
+	// Keep the mount table open, the kernel signals POLLPRI on every change.
+	//
+	mountinfo = open("/proc/self/mountinfo",O_RDONLY|O_CLOEXEC);
+	if(mountinfo < 0) {
+		warning() << "Can't open /proc/self/mountinfo, mount table changes will be ignored" << endl;
+	}
+
+	try {
+		Udjat::Backend::getInstance().mountinfo(mounts,mountinfo);
+	} catch(const std::exception &e) {
+		warning() << e.what() << endl;
+	}
+
+	// Per-cgroup throughput, mapped to the mount points of each disk.
+	{
+		const char *subtree = node.attribute("cgroups").as_string();
+		if(*subtree) {
+			cgroups = make_shared<CGroups>(subtree,node);
+			cgroups->set(mounts);
+			Udjat::Abstract::Agent::push_back(cgroups);
+		}
+	}
+
+	// Dirty pages and writeback, mapped to the mount points of each backing device.
+	if(node.attribute("writeback").as_bool(false)) {
+		writeback = make_shared<WritebackAgent>("writeback",node);
+		writeback->set(mounts);
+		Udjat::Abstract::Agent::push_back(writeback);
+	}
+
+	// Block queue settings of the disks behind the mount points.
+	if(node.attribute("queues").as_bool(false)) {
+		queues = make_shared<QueueAgent>("queues",node);
+		queues->set(mounts);
+		Udjat::Abstract::Agent::push_back(queues);
+	}
+
+#ifdef HAVE_INSTRUMENTATION
+	timings.mountinfo = Udjat::Instrumentation::now() - phase;
+	phase = Udjat::Instrumentation::now();
+#endif // HAVE_INSTRUMENTATION
+
+	// Get mount points, joining devices and mounts by major:minor.
+	for(auto &device : devices) {
+
+		if(!device.dev) {
+			struct stat st;
+			if(stat(device.devname.c_str(),&st) || !S_ISBLK(st.st_mode)) {
+				continue;
+			}
+			device.dev = st.st_rdev;
+		}
+
+		const Udjat::MountInfo::Entry *entry = mounts.find(device.dev);
+		if(entry) {
+			device.mountpoint = entry->mount_point;
+			info()	<< "Using " << device.mountpoint.c_str()
+					<< " as mount point for " << device.devname
+					<< " (" << device.label << ")"
+					<< endl;
+		}
+
+	}
+
+#ifdef HAVE_INSTRUMENTATION
+	timings.join = Udjat::Instrumentation::now() - phase;
+	phase = Udjat::Instrumentation::now();
+#endif // HAVE_INSTRUMENTATION
+
+	// Create agents
+	{
+
+		for(auto device = devices.begin(); device != devices.end(); device++) {
+
+			if(device->mountpoint.empty()) {
+				continue;
+			}
+
+			// Check for ignore-[type] attribute
+			if(Udjat::Attribute(node,(string{"ignore-"} + device->type).c_str()).as_bool(false)) {
+				ignored.insert(device->type);
+			}
+
+			if(ignore(device->type)) {
+				info() << "Ignoring '" << device->mountpoint.c_str() << "'" << endl;
+				continue;
+			}
+
+			insert(::Agent::Metadata::build(device->mountpoint.c_str(),device->label.c_str(),device->devname.c_str(),device->type.c_str(),device->dev));
+
+		}
+
+	}
+
+#ifdef HAVE_INSTRUMENTATION
+	timings.agents = Udjat::Instrumentation::now() - phase;
+#endif // HAVE_INSTRUMENTATION
+
+	//
+	// Raw exports, started after the agents: the handlers run on the endpoint thread.
+	// Each exporting container needs its own port.
+	//
+	{
+		unsigned short port = (unsigned short) node.attribute("http-port").as_uint(metrics ? 9101 : 0);
+		if(port) {
+			try {
+				endpoint = make_unique<Udjat::Endpoint>(node.attribute("http-address").as_string(""),port);
+			} catch(const std::exception &e) {
+				error() << "Can't serve raw exports: " << e.what() << endl;
+			}
+		}
+	}
+
+	if(endpoint) {
+
+		endpoint->insert("/disks",[this](const Udjat::Endpoint::Request &request, Udjat::Endpoint::Reply &reply) {
+
+			std::lock_guard<std::mutex> lock(snapshot.guard);
+
+			if(snapshot.revision != *revision) {
+				rebuild();
+			}
+
+			reply.etag = snapshot.etag;
+			if(request.etag == snapshot.etag) {
+				reply.status = "304 Not Modified";
+				return;
+			}
+
+			reply.type = "application/json; charset=utf-8";
+			reply.body = snapshot.json;
+
+		});
+
+		if(metrics) {
+
+			endpoint->insert("/metrics",[this](const Udjat::Endpoint::Request &request, Udjat::Endpoint::Reply &reply) {
+
+				auto text = make_shared<std::string>();
+				metrics->render(*text);
+
+				if(request.accept.find("application/openmetrics-text") != std::string::npos) {
+					reply.type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+				} else {
+					reply.type = "text/plain; version=0.0.4; charset=utf-8";
+				}
+				reply.body = text;
+
+			});
+
+		}
+
+	}
+
+ }
+
+ Container::~Container() {
+	if(mountinfo >= 0) {
+		Udjat::MainLoop::getInstance().remove(this);
+		::close(mountinfo);
+	}
+ }
+
+ void Container::start() {
+
+	Udjat::Abstract::Agent::start();
+	started = true;
+
+	if(mountinfo >= 0) {
+		Udjat::MainLoop::getInstance().insert(this,mountinfo,(Udjat::MainLoop::Event) (POLLPRI|POLLERR),[this](const Udjat::MainLoop::Event) {
+			try {
+				reload();
+			} catch(const std::exception &e) {
+				error() << "Error loading mount table: " << e.what() << endl;
+			}
+			return true;
+		});
+	}
+
+ }
+
+ bool Container::ignore(const std::string &type) const noexcept {
+	return ignored.find(type) != ignored.end();
+ }
+
+ std::shared_ptr<::Agent> Container::find(const char *mount_point) {
+
+	for(auto child : *this) {
+		auto agent = dynamic_pointer_cast<::Agent>(child);
+		if(agent && !strcmp(agent->getMountPoint(),mount_point)) {
+			return agent;
+		}
+	}
+
+	return std::shared_ptr<::Agent>();
+
+ }
+
+ void Container::insert(std::shared_ptr<const ::Agent::Metadata> metadata) {
+
+	dev_t device = metadata->dev;
+	std::shared_ptr<::Agent> child{std::make_shared<::Agent>(metadata)};
+
+	child->setInterval(interval);
+	child->setTimeout(timeout);
+	child->setWatch(watch);
+	child->setCanary(canary);
+
+	std::shared_ptr<IOAgent> io;
+	if(iostats && device) {
+		io = std::make_shared<IOAgent>(device);
+		child->push_back(io);
+	}
+
+	if(topfiles) {
+		child->push_back(std::make_shared<FilesAgent>(child->getMountPoint(),topfiles,tracked));
+	}
+
+	if(metrics) {
+		metrics->insert(child,io);
+	}
+
+	child->setRevision(revision);
+
+	Udjat::Abstract::Agent::push_back(child);
+	(*revision)++;
+
+	if(started) {
+		child->start();
+	}
+
+ }
+
+ void Container::reload() {
+
+	Udjat::MountInfo current;
+	Udjat::Backend::getInstance().mountinfo(current,mountinfo);
+
+	// Filesystem handles can point to detached mounts.
+	Udjat::FileSystem::remounted();
+
+	// The endpoint thread walks the children on rebuild().
+	std::unique_lock<std::mutex> lock(tree);
+
+	// Retire agents for unmounted (or replaced) filesystems.
+	for(const auto &entry : mounts) {
+
+		const Udjat::MountInfo::Entry *mounted = current.find(entry.mount_point.c_str());
+		if(mounted && mounted->dev == entry.dev) {
+			continue;
+		}
+
+		auto agent = find(entry.mount_point.c_str());
+		if(agent) {
+			info() << "'" << entry.mount_point << "' was unmounted" << endl;
+			if(metrics) {
+				metrics->remove(agent.get());
+			}
+			Udjat::Abstract::Agent::remove(agent);
+			(*revision)++;
+		}
+
+	}
+
+	// Devices already monitored (through any mount point).
+	std::set<dev_t> monitored;
+	for(auto child : *this) {
+		auto agent = dynamic_cast<::Agent *>(child.get());
+		if(agent && agent->metadata().dev) {
+			monitored.insert(agent->metadata().dev);
+		}
+	}
+
+	// Create agents for block devices without one, on their primary mount as on startup
+	// (bind mounts and subvolumes of a monitored disk are skipped; if the primary mount
+	// went away the next one takes over).
+	for(const auto &entry : current) {
+
+		if(!entry.device || ignore(entry.type)) {
+			continue;
+		}
+
+		if(current.find(entry.device) != &entry || monitored.count(entry.device) || find(entry.mount_point.c_str())) {
+			continue;
+		}
+
+		string label;
+		{
+			char *value = blkid_get_tag_value(NULL,"LABEL",entry.source.c_str());
+			if(value) {
+				label = value;
+				free(value);
+			}
+		}
+
+		info()	<< "Using " << entry.mount_point
+				<< " as mount point for " << entry.source
+				<< " (" << label << ")"
+				<< endl;
+
+		insert(::Agent::Metadata::build(entry.mount_point.c_str(),label.c_str(),entry.source.c_str(),entry.type.c_str(),entry.device));
+		monitored.insert(entry.device);
+
+	}
+
+	lock.unlock();
+
+	mounts = std::move(current);
+
+	if(cgroups) {
+		cgroups->set(mounts);
+	}
+
+	if(writeback) {
+		writeback->set(mounts);
+	}
+
+	if(queues) {
+		queues->set(mounts);
+	}
+
+ }
+
+ void Container::rebuild() {
+
+	std::lock_guard<std::mutex> lock(tree);
+
+	size_t count = 0;
+
+	// Keep the items (and their string buffers) between rebuilds.
+	snapshot.revision = *revision;
+	snapshot.modified = time(nullptr);
+	snapshot.memory = 0;
+
+	for(auto child : *this) {
+
+		auto agent = dynamic_cast<::Agent *>(child.get());
+		if(!agent)
+			continue;
+
+		if(count >= snapshot.items.size()) {
+			snapshot.items.resize(count+1);
+		}
+
+		Snapshot::Item &item = snapshot.items[count++];
+		auto state = agent->state();
+
+		item.name = agent->name();
+		item.summary = agent->summary();
+		item.icon = agent->icon();
+		item.state = state->summary();
+		item.mp = agent->getMountPoint();
+
+		snprintf(item.level,sizeof(item.level),"%u",(unsigned int) state->level());
+		snprintf(item.used,sizeof(item.used),"%.2f%%",agent->getSnapshot().used);
+
+		item.rate = (float) (agent->rate() * 3600);
+
+		double ttf = agent->ttf();
+		item.ttf = (ttf < 0 ? -1 : (long) ttf);
+
+		snapshot.memory += agent->memory();
+
+	}
+
+	snapshot.items.resize(count);
+
+	// Serialized once, shared with the replies still being sent.
+	{
+		auto json = make_shared<std::string>();
+		json->reserve(128 + (count * 256));
+
+		char buffer[64];
+		snprintf(buffer,sizeof(buffer),"{\"version\":%u,\"disks\":[",snapshot.revision);
+		json->append(buffer);
+
+		for(size_t ix = 0; ix < count; ix++) {
+
+			const Snapshot::Item &item = snapshot.items[ix];
+
+			if(ix) {
+				json->append(",");
+			}
+
+			json->append("{\"name\":");
+			escape(*json,item.name);
+			json->append(",\"summary\":");
+			escape(*json,item.summary);
+			json->append(",\"icon\":");
+			escape(*json,item.icon);
+			json->append(",\"state\":");
+			escape(*json,item.state);
+			json->append(",\"level\":");
+			escape(*json,item.level);
+			json->append(",\"used\":");
+			escape(*json,item.used);
+			json->append(",\"mp\":");
+			escape(*json,item.mp);
+
+			snprintf(buffer,sizeof(buffer),",\"rate\":%g,\"ttf\":%ld}",(std::isfinite(item.rate) ? (double) item.rate : 0.0),item.ttf);
+			json->append(buffer);
+
+		}
+
+		json->append("]}");
+
+		snapshot.json = json;
+		snapshot.etag = "\"" + std::to_string(snapshot.revision) + "\"";
+	}
+
+ }
+
+ void Container::get(const Udjat::Request &request, Udjat::Response &response) {
+
+	Udjat::Abstract::Agent::get(request,response);
+
+	std::lock_guard<std::mutex> lock(snapshot.guard);
+
+	if(snapshot.revision != *revision) {
+		rebuild();
+	}
+
+	// Lets the HTTP layer send Last-Modified and answer If-Modified-Since with 304.
+	response.setModificationTimestamp(snapshot.modified);
+	response["version"] = snapshot.revision;
+
+	{
+		Udjat::Value &memory = response["memory"];
+		memory["agents"] = (unsigned long long) snapshot.memory;
+		memory["per-agent"] = (unsigned long long) (snapshot.items.empty() ? 0 : snapshot.memory / snapshot.items.size());
+		memory["strings"] = (unsigned long long) Udjat::Atom::count();
+		memory["string-bytes"] = (unsigned long long) Udjat::Atom::bytes();
+	}
+
+#ifdef HAVE_INSTRUMENTATION
+	{
+		Udjat::Value &instrumentation = response["instrumentation"];
+
+		Udjat::Value &startup = instrumentation["startup"];
+		startup["discovery"] = (unsigned long long) timings.discovery;
+		startup["mountinfo"] = (unsigned long long) timings.mountinfo;
+		startup["join"] = (unsigned long long) timings.join;
+		startup["agents"] = (unsigned long long) timings.agents;
+
+		Udjat::Instrumentation::syscalls().get(instrumentation["syscalls"]);
+	}
+#endif // HAVE_INSTRUMENTATION
+
+	Udjat::Value &devices = response["disks"];
+
+	for(const auto &item : snapshot.items) {
+
+		Udjat::Value &device = devices.append(Udjat::Value::Object);
+
+		device["name"] = item.name;
+		device["summary"] = item.summary;
+		device["icon"] = item.icon;
+		device["state"] = item.state;
+		device["level"] = item.level;
+		device["used"] = item.used;
+		device["mp"] = item.mp;
+		device["rate"] = item.rate;		// %/hour
+		device["ttf"] = item.ttf;		// seconds, -1 if not growing
+
+	}
+
+	if(processes) {
+		processes->report(response["processes"]);
+	}
+
+	if(cgroups) {
+		cgroups->report(response["cgroups"]);
+	}
+
+	if(writeback) {
+		writeback->report(response["writeback"]);
+	}
+
+	if(queues) {
+		queues->report(response["queues"]);
+	}
+
+	if(topfiles) {
+
+		// Largest and fastest growing files, changed independently from the disk revision.
+		Udjat::Value &files = response["files"];
+
+		std::lock_guard<std::mutex> lock(tree);
+		for(auto child : *this) {
+			auto agent = dynamic_cast<::Agent *>(child.get());
+			if(!agent)
+				continue;
+
+			for(auto grandchild : *agent) {
+				auto tracker = dynamic_cast<FilesAgent *>(grandchild.get());
+				if(tracker) {
+					Udjat::Value &item = files.append(Udjat::Value::Object);
+					item["mp"] = agent->getMountPoint();
+					tracker->report(item);
+				}
+			}
+		}
+
+	}
+
+ }
+
+ void Container::invalidate() noexcept {
+	(*revision)++;
+ }
@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/diskstats.h>
+ #include <udjat/backend.h>
+ #include <sys/sysmacros.h>
+ #include <unordered_map>
+ #include <mutex>
+ #include <string>
+ #include <cstdlib>
+ #include <cstring>
+ #include <ctime>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	/// @brief Minimum age (in seconds) of the loaded sample before reading /proc/diskstats again.
+	static const double max_age = 0.5;
+
+	static double monotonic() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+	}
+
+	void DiskStats::parse(const char *text, double timestamp, const std::function<void(dev_t dev, const Counters &counters)> &call) {
+
+		while(*text) {
+
+			//    8       0 sda 12345 ...
+			char *ptr;
+			unsigned int major = (unsigned int) strtoul(text,&ptr,10);
+			unsigned int minor = (unsigned int) strtoul(ptr,&ptr,10);
+
+			while(*ptr == ' ') {
+				ptr++;
+			}
+			while(*ptr && *ptr != ' ' && *ptr != '\n') {
+				ptr++;
+			}
+
+			Counters counters;
+			counters.timestamp = timestamp;
+
+			uint64_t values[11];
+			for(size_t ix = 0; ix < (sizeof(values)/sizeof(values[0])); ix++) {
+				values[ix] = strtoull(ptr,&ptr,10);
+			}
+
+			counters.reads = values[0];
+			counters.read_sectors = values[2];
+			counters.read_ms = values[3];
+			counters.writes = values[4];
+			counters.write_sectors = values[6];
+			counters.write_ms = values[7];
+			counters.in_flight = values[8];
+			counters.io_ms = values[9];
+			counters.weighted_ms = values[10];
+
+			call(makedev(major,minor),counters);
+
+			const char *eol = strchr(ptr,'\n');
+			if(!eol) {
+				break;
+			}
+			text = eol+1;
+
+		}
+
+	}
+
+	bool DiskStats::get(dev_t dev, Counters &counters) {
+
+		static std::mutex guard;
+		static std::unordered_map<dev_t,Counters> devices;
+		static double timestamp = 0;
+		static string text;
+
+		std::lock_guard<std::mutex> lock(guard);
+
+		double now = monotonic();
+
+		if(now - timestamp >= max_age) {
+
+			Backend::getInstance().diskstats(text);
+
+			timestamp = now;
+			devices.clear();
+			parse(text.c_str(),now,[](dev_t dev, const Counters &counters){
+				devices[dev] = counters;
+			});
+
+		}
+
+		auto it = devices.find(dev);
+		if(it == devices.end()) {
+			return false;
+		}
+
+		counters = it->second;
+		return true;
+
+	}
+
+	DiskStats::Rates::Rates(const Counters &previous, const Counters &current) {
+
+		double seconds = current.timestamp - previous.timestamp;
+		if(seconds <= 0) {
+			return;
+		}
+
+		uint64_t ios = (current.reads - previous.reads) + (current.writes - previous.writes);
+
+		iops = (float) (((double) ios) / seconds);
+		read = (float) (((double) (current.read_sectors - previous.read_sectors)) * 512.0 / seconds);
+		write = (float) (((double) (current.write_sectors - previous.write_sectors)) * 512.0 / seconds);
+
+		if(ios) {
+			await = (float) (((double) ((current.read_ms - previous.read_ms) + (current.write_ms - previous.write_ms))) / ((double) ios));
+		}
+
+		queue = (float) (((double) (current.weighted_ms - previous.weighted_ms)) / (seconds * 1000.0));
+		util = (float) (((double) (current.io_ms - previous.io_ms)) / (seconds * 10.0));
+		if(util > 100) {
+			util = 100;
+		}
+
+	}
+
+ }
@@ -0,0 +1,479 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/diskusage.h>
+ #include <atomic>
+ #include <chrono>
+ #include <condition_variable>
+ #include <cstring>
+ #include <deque>
+ #include <memory>
+ #include <system_error>
+ #include <thread>
+ #include <algorithm>
+ #include <fcntl.h>
+ #include <sys/stat.h>
+ #include <sys/syscall.h>
+ #include <dirent.h>
+ #include <unistd.h>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	/// @brief Directory entry, as returned by getdents64.
+	struct linux_dirent64 {
+		ino64_t d_ino;
+		off64_t d_off;
+		unsigned short d_reclen;
+		unsigned char d_type;
+		char d_name[256];
+	};
+
+	static inline int64_t nanoseconds(const struct statx_timestamp &ts) noexcept {
+		return (((int64_t) ts.tv_sec) * 1000000000LL) + ts.tv_nsec;
+	}
+
+	/// @brief State of a single scan.
+	struct DiskUsage::Walk {
+
+		struct Task {
+			std::string path;
+			size_t slot;		///< @brief Top-level entry.
+			ino_t ino;
+			int64_t mtime;
+		};
+
+		/// @brief Per-worker queue; the owner works from the back, thieves take from the front.
+		struct Queue {
+			std::mutex guard;
+			std::deque<Task> tasks;
+		};
+
+		struct Slot {
+			std::atomic<uint64_t> bytes{0};
+			std::atomic<uint64_t> files{0};
+		};
+
+		DiskUsage &du;
+
+		/// @brief Device of the scanned path, other filesystems are skipped.
+		unsigned int major;
+		unsigned int minor;
+
+		size_t workers;
+		std::unique_ptr<Queue[]> queues;
+		std::unique_ptr<Slot[]> slots;
+
+		/// @brief Tasks queued or running.
+		std::atomic<size_t> pending{0};
+
+		/// @brief Tasks waiting in the queues (changed with the queue locked).
+		std::atomic<size_t> queued{0};
+
+		/// @brief Idle workers wait here for new tasks or the end of the walk.
+		std::mutex idle;
+		std::condition_variable wake;
+
+		/// @brief File visitor, cache is bypassed when set.
+		const Visitor *visitor = nullptr;
+
+		std::atomic<uint64_t> directories{0};
+		std::atomic<uint64_t> listed{0};
+		std::atomic<uint64_t> errors{0};
+
+		Walk(DiskUsage &d, const struct statx &root, size_t w, size_t entries)
+			: du(d), major(root.stx_dev_major), minor(root.stx_dev_minor), workers(w), queues(new Queue[w]), slots(new Slot[entries]) {
+		}
+
+		void push(size_t worker, Task &&task) {
+			pending++;
+			{
+				std::lock_guard<std::mutex> lock(queues[worker].guard);
+				queues[worker].tasks.push_back(std::move(task));
+				queued++;
+			}
+			signal(false);
+		}
+
+		/// @brief Wake idle workers.
+		/// @param all true to wake all of them (the walk is finished).
+		void signal(bool all) {
+			// Taking the lock orders this with the predicate check of a worker going to sleep.
+			std::lock_guard<std::mutex> lock(idle);
+			if(all) {
+				wake.notify_all();
+			} else {
+				wake.notify_one();
+			}
+		}
+
+		bool pop(size_t worker, Task &task) {
+			std::lock_guard<std::mutex> lock(queues[worker].guard);
+			if(queues[worker].tasks.empty()) {
+				return false;
+			}
+			task = std::move(queues[worker].tasks.back());
+			queues[worker].tasks.pop_back();
+			queued--;
+			return true;
+		}
+
+		bool steal(size_t worker, Task &task) {
+			for(size_t ix = 1; ix < workers; ix++) {
+				Queue &victim = queues[(worker + ix) % workers];
+				std::lock_guard<std::mutex> lock(victim.guard);
+				if(!victim.tasks.empty()) {
+					task = std::move(victim.tasks.front());
+					victim.tasks.pop_front();
+					queued--;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/// @brief Run the queued tasks on the worker pool.
+		void execute() {
+			std::vector<std::thread> pool;
+			pool.reserve(workers - 1);
+			for(size_t ix = 1; ix < workers; ix++) {
+				pool.emplace_back(&Walk::run,this,ix);
+			}
+			run(0);
+			for(auto &thread : pool) {
+				thread.join();
+			}
+		}
+
+		void run(size_t worker) {
+			Task task;
+			for(;;) {
+				if(pop(worker,task) || steal(worker,task)) {
+					process(worker,task);
+					if(--pending == 0) {
+						signal(true);
+					}
+				} else {
+					std::unique_lock<std::mutex> lock(idle);
+					wake.wait(lock,[this]{ return !pending || queued; });
+					if(!pending) {
+						return;
+					}
+				}
+			}
+		}
+
+		/// @brief Read directory, sum the file sizes.
+		/// @return 0 on success, errno on failure.
+		int list(const char *path, Node &node) {
+
+			int fd = open(path,O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+			if(fd < 0) {
+				return errno;
+			}
+
+			char buffer[32768];
+			long length;
+
+			while((length = syscall(SYS_getdents64,fd,buffer,sizeof(buffer))) > 0) {
+
+				for(long offset = 0; offset < length;) {
+
+					const linux_dirent64 *entry = (const linux_dirent64 *) (buffer + offset);
+					offset += entry->d_reclen;
+
+					const char *name = entry->d_name;
+					if(name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]))) {
+						continue;
+					}
+
+					if(entry->d_type == DT_DIR) {
+						node.subdirs.emplace_back(name);
+						continue;
+					}
+
+					struct statx st;
+					if(statx(fd,name,AT_SYMLINK_NOFOLLOW|AT_STATX_DONT_SYNC,(visitor ? STATX_BASIC_STATS : STATX_TYPE|STATX_BLOCKS),&st)) {
+						errors++;
+						continue;
+					}
+
+					if(S_ISDIR(st.stx_mode)) {
+						// DT_UNKNOWN on filesystems without d_type.
+						node.subdirs.emplace_back(name);
+						continue;
+					}
+
+					node.bytes += st.stx_blocks * 512;
+					node.files++;
+
+					if(visitor && S_ISREG(st.stx_mode)) {
+						std::string filename{path};
+						if(filename.back() != '/') {
+							filename += '/';
+						}
+						filename += name;
+						(*visitor)(filename,st);
+					}
+
+				}
+
+			}
+
+			int rc = (length < 0 ? errno : 0);
+			::close(fd);
+			return rc;
+
+		}
+
+		/// @brief Check subdirectory, queue it if in the same filesystem.
+		/// @param bytes Allocated bytes of the subdirectory itself.
+		/// @return false if the subdirectory was skipped.
+		bool child(size_t worker, const std::string &parent, const std::string &name, size_t slot, uint64_t &bytes) {
+
+			Task task;
+			task.path.reserve(parent.size() + name.size() + 1);
+			task.path = parent;
+			task.path += '/';
+			task.path += name;
+			task.slot = slot;
+
+			struct statx st;
+			if(statx(AT_FDCWD,task.path.c_str(),AT_SYMLINK_NOFOLLOW|AT_STATX_DONT_SYNC,STATX_TYPE|STATX_INO|STATX_MTIME|STATX_BLOCKS,&st)) {
+				errors++;
+				return false;
+			}
+
+			if(!S_ISDIR(st.stx_mode) || st.stx_dev_major != major || st.stx_dev_minor != minor) {
+				return false;
+			}
+
+			task.ino = st.stx_ino;
+			task.mtime = nanoseconds(st.stx_mtime);
+			bytes = st.stx_blocks * 512;
+
+			push(worker,std::move(task));
+			return true;
+
+		}
+
+		void process(size_t worker, const Task &task) {
+
+			directories++;
+
+			Shard &shard = du.cache[task.ino % shards];
+			std::vector<std::string> subdirs;
+			uint64_t bytes = 0;
+			uint64_t files = 0;
+			bool cached = false;
+
+			if(!visitor) {
+				std::lock_guard<std::mutex> lock(shard.guard);
+				auto node = shard.nodes.find(task.ino);
+				if(node != shard.nodes.end() && node->second.mtime == task.mtime) {
+					node->second.generation = du.generation;
+					bytes = node->second.bytes;
+					files = node->second.files;
+					subdirs = node->second.subdirs;
+					cached = true;
+				}
+			}
+
+			if(!cached) {
+
+				Node node;
+				if(list(task.path.c_str(),node)) {
+					errors++;
+					return;
+				}
+				listed++;
+
+				node.mtime = task.mtime;
+				node.generation = du.generation;
+				bytes = node.bytes;
+				files = node.files;
+
+				if(visitor) {
+					subdirs = std::move(node.subdirs);
+				} else {
+					subdirs = node.subdirs;
+					std::lock_guard<std::mutex> lock(shard.guard);
+					shard.nodes[task.ino] = std::move(node);
+				}
+
+			}
+
+			for(const auto &name : subdirs) {
+				uint64_t size;
+				if(child(worker,task.path,name,task.slot,size)) {
+					bytes += size;
+					files++;
+				}
+			}
+
+			slots[task.slot].bytes += bytes;
+			slots[task.slot].files += files;
+
+		}
+
+	};
+
+	DiskUsage::DiskUsage(unsigned int t) : threads(t) {
+	}
+
+	size_t DiskUsage::workers() const noexcept {
+		// The walk is bound by the storage, not the CPU; a few threads keep the queue full.
+		return threads ? threads : 4;
+	}
+
+	/// @brief Strip trailing slashes, "/" becomes empty (children are parent + '/' + name).
+	static std::string normalize(const char *path) {
+		std::string parent{path};
+		while(!parent.empty() && parent.back() == '/') {
+			parent.pop_back();
+		}
+		return parent;
+	}
+
+	DiskUsage::~DiskUsage() {
+	}
+
+	void DiskUsage::invalidate() noexcept {
+		for(auto &shard : cache) {
+			std::lock_guard<std::mutex> lock(shard.guard);
+			shard.nodes.clear();
+		}
+	}
+
+	void DiskUsage::scan(const char *path, std::vector<Entry> &entries) {
+
+		auto started = std::chrono::steady_clock::now();
+
+		generation++;
+
+		struct statx root;
+		if(statx(AT_FDCWD,path,0,STATX_TYPE|STATX_INO|STATX_MTIME,&root)) {
+			throw system_error(errno,system_category(),path);
+		}
+
+		if(!S_ISDIR(root.stx_mode)) {
+			throw system_error(ENOTDIR,system_category(),path);
+		}
+
+		// The top-level listing is always read, it defines the entries.
+		Node top;
+		{
+			Walk walk{*this,root,1,0};
+			int rc = walk.list(path,top);
+			if(rc) {
+				throw system_error(rc,system_category(),path);
+			}
+		}
+
+		size_t workers = this->workers();
+		Walk walk{*this,root,workers,top.subdirs.size()};
+		std::string parent{normalize(path)};
+
+		// Seed the queues, the workers steal from each other after that.
+		std::vector<bool> mounted(top.subdirs.size(),false);
+		for(size_t ix = 0; ix < top.subdirs.size(); ix++) {
+			uint64_t bytes;
+			if(walk.child(ix % workers,parent,top.subdirs[ix],ix,bytes)) {
+				mounted[ix] = true;
+				walk.slots[ix].bytes += bytes;
+				walk.slots[ix].files++;
+			}
+		}
+
+		walk.execute();
+
+		entries.clear();
+		entries.reserve(top.subdirs.size());
+		for(size_t ix = 0; ix < top.subdirs.size(); ix++) {
+			if(mounted[ix]) {
+				Entry entry;
+				entry.name = top.subdirs[ix];
+				entry.bytes = walk.slots[ix].bytes;
+				entry.files = walk.slots[ix].files;
+				entries.push_back(std::move(entry));
+			}
+		}
+
+		std::sort(entries.begin(),entries.end(),[](const Entry &a, const Entry &b){
+			return a.bytes > b.bytes;
+		});
+
+		// Drop nodes of removed directories.
+		for(auto &shard : cache) {
+			std::lock_guard<std::mutex> lock(shard.guard);
+			for(auto node = shard.nodes.begin(); node != shard.nodes.end();) {
+				if(node->second.generation != generation) {
+					node = shard.nodes.erase(node);
+				} else {
+					node++;
+				}
+			}
+		}
+
+		counters.directories = walk.directories;
+		counters.listed = walk.listed;
+		counters.errors = walk.errors;
+		counters.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	}
+
+	void DiskUsage::walk(const char *path, const Visitor &visitor) {
+
+		struct statx root;
+		if(statx(AT_FDCWD,path,0,STATX_TYPE|STATX_INO|STATX_MTIME,&root)) {
+			throw system_error(errno,system_category(),path);
+		}
+
+		if(!S_ISDIR(root.stx_mode)) {
+			throw system_error(ENOTDIR,system_category(),path);
+		}
+
+		size_t workers = this->workers();
+		Walk walk{*this,root,workers,1};
+		walk.visitor = &visitor;
+
+		Node top;
+		int rc = walk.list(path,top);
+		if(rc) {
+			throw system_error(rc,system_category(),path);
+		}
+
+		std::string parent{normalize(path)};
+		for(size_t ix = 0; ix < top.subdirs.size(); ix++) {
+			uint64_t bytes;
+			walk.child(ix % workers,parent,top.subdirs[ix],0,bytes);
+		}
+
+		walk.execute();
+
+		counters.directories = walk.directories;
+		counters.listed = walk.listed;
+		counters.errors = walk.errors;
+
+	}
+
+ }
@@ -0,0 +1,264 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/endpoint.h>
+ #include <system_error>
+ #include <iostream>
+ #include <algorithm>
+ #include <cstdio>
+ #include <cstring>
+ #include <fcntl.h>
+ #include <netdb.h>
+ #include <poll.h>
+ #include <sys/socket.h>
+ #include <sys/time.h>
+ #include <unistd.h>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	Endpoint::Endpoint(const char *address, unsigned short port) {
+
+		struct addrinfo hints;
+		memset(&hints,0,sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_PASSIVE|AI_NUMERICHOST|AI_NUMERICSERV;
+
+		char service[8];
+		snprintf(service,sizeof(service),"%u",(unsigned int) port);
+
+		struct addrinfo *result = nullptr;
+		int rc = getaddrinfo((address && *address) ? address : nullptr,service,&hints,&result);
+		if(rc) {
+			throw runtime_error(string{"Invalid endpoint address '"} + address + "': " + gai_strerror(rc));
+		}
+
+		int err = 0;
+		for(struct addrinfo *ai = result; ai && sock < 0; ai = ai->ai_next) {
+
+			sock = socket(ai->ai_family,ai->ai_socktype|SOCK_CLOEXEC,ai->ai_protocol);
+			if(sock < 0) {
+				err = errno;
+				continue;
+			}
+
+			int on = 1;
+			setsockopt(sock,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on));
+
+			if(bind(sock,ai->ai_addr,ai->ai_addrlen) || ::listen(sock,16)) {
+				err = errno;
+				::close(sock);
+				sock = -1;
+			}
+
+		}
+
+		freeaddrinfo(result);
+
+		if(sock < 0) {
+			throw system_error(err,system_category(),string{"Can't listen on port "} + service);
+		}
+
+		if(pipe2(stop,O_CLOEXEC)) {
+			err = errno;
+			::close(sock);
+			throw system_error(err,system_category(),"Can't create endpoint pipe");
+		}
+
+		server = std::thread([this]{ serve(); });
+
+	}
+
+	Endpoint::~Endpoint() {
+
+		if(write(stop[1],"",1) < 0) {
+			// Can't wake the thread, leave it with its descriptors.
+			cerr << "endpoint\tCan't stop the HTTP endpoint: " << strerror(errno) << endl;
+			server.detach();
+			return;
+		}
+
+		server.join();
+
+		for(int fd : { sock, stop[0], stop[1] }) {
+			::close(fd);
+		}
+
+	}
+
+	void Endpoint::insert(const char *path, const Handler &handler) {
+		std::lock_guard<std::mutex> lock(guard);
+		handlers[path] = handler;
+	}
+
+	void Endpoint::serve() {
+
+		for(;;) {
+
+			struct pollfd fds[2];
+			fds[0].fd = sock;
+			fds[0].events = POLLIN;
+			fds[1].fd = stop[0];
+			fds[1].events = POLLIN;
+
+			if(poll(fds,2,-1) < 0) {
+				if(errno == EINTR) {
+					continue;
+				}
+				cerr << "endpoint\tHTTP endpoint failed: " << strerror(errno) << endl;
+				return;
+			}
+
+			if(fds[1].revents) {
+				return;
+			}
+
+			if(!(fds[0].revents & POLLIN)) {
+				continue;
+			}
+
+			int client = accept4(sock,nullptr,nullptr,SOCK_CLOEXEC);
+			if(client < 0) {
+				continue;
+			}
+
+			// A stuck client must not hold the endpoint.
+			struct timeval timeout = { 5, 0 };
+			setsockopt(client,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+			setsockopt(client,SOL_SOCKET,SO_SNDTIMEO,&timeout,sizeof(timeout));
+
+			try {
+				reply(client);
+			} catch(const std::exception &e) {
+				cerr << "endpoint\t" << e.what() << endl;
+			}
+
+			::close(client);
+
+		}
+
+	}
+
+	/// @brief Send the whole buffer.
+	static bool send(int fd, const char *data, size_t length) {
+		size_t sent = 0;
+		while(sent < length) {
+			ssize_t bytes = ::send(fd,data+sent,length-sent,MSG_NOSIGNAL);
+			if(bytes <= 0) {
+				return false;
+			}
+			sent += bytes;
+		}
+		return true;
+	}
+
+	/// @brief Get header value from the (lowercase) request head.
+	static std::string header(const std::string &lower, const std::string &request, const char *name) {
+
+		size_t pos = lower.find(std::string{"\r\n"} + name + ":");
+		if(pos == std::string::npos) {
+			return std::string{};
+		}
+
+		pos += strlen(name) + 3;
+		size_t end = request.find("\r\n",pos);
+
+		std::string value{request,pos,(end == std::string::npos ? end : end - pos)};
+		value.erase(0,value.find_first_not_of(" \t"));
+		return value;
+
+	}
+
+	void Endpoint::reply(int client) {
+
+		std::string request;
+		char chunk[1024];
+
+		while(request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+			ssize_t bytes = recv(client,chunk,sizeof(chunk),0);
+			if(bytes <= 0) {
+				return;
+			}
+			request.append(chunk,bytes);
+		}
+
+		Request req;
+		Reply rep;
+
+		req.head = !strncmp(request.c_str(),"HEAD ",5);
+
+		if(!req.head && strncmp(request.c_str(),"GET ",4)) {
+
+			rep.status = "405 Method Not Allowed";
+
+		} else {
+
+			size_t from = request.find(' ') + 1;
+			size_t to = request.find_first_of(" ?",from);
+			std::string path{request,from,(to == std::string::npos ? to : to - from)};
+
+			std::string lower{request};
+			std::transform(lower.begin(),lower.end(),lower.begin(),::tolower);
+			req.accept = header(lower,request,"accept");
+			req.etag = header(lower,request,"if-none-match");
+
+			Handler handler;
+			{
+				std::lock_guard<std::mutex> lock(guard);
+				auto it = handlers.find(path);
+				if(it != handlers.end()) {
+					handler = it->second;
+				}
+			}
+
+			if(handler) {
+				handler(req,rep);
+			} else {
+				rep.status = "404 Not Found";
+			}
+
+		}
+
+		if(!rep.body && strcmp(rep.status,"304 Not Modified")) {
+			rep.body = std::make_shared<std::string>(std::string{rep.status} + "\n");
+		}
+
+		std::string head{"HTTP/1.1 "};
+		head += rep.status;
+		head += "\r\nContent-Type: ";
+		head += rep.type;
+		head += "\r\nContent-Length: ";
+		head += std::to_string(rep.body ? rep.body->size() : 0);
+		if(!rep.etag.empty()) {
+			head += "\r\nETag: ";
+			head += rep.etag;
+		}
+		head += "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n";
+
+		if(send(client,head.data(),head.size()) && !req.head && rep.body) {
+			send(client,rep.body->data(),rep.body->size());
+		}
+
+	}
+
+ }
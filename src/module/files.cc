@@ -0,0 +1,283 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <files.h>
+ #include <udjat/diskusage.h>
+ #include <udjat/tools/mainloop.h>
+ #include <udjat/tools/intl.h>
+ #include <udjat/tools/logger.h>
+ #include <climits>
+ #include <cstring>
+ #include <ctime>
+ #include <fcntl.h>
+ #include <sys/stat.h>
+ #include <thread>
+ #include <unistd.h>
+
+ using namespace std;
+
+ static double monotonic() noexcept {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+ }
+
+ FilesAgent::FilesAgent(const char *mp, size_t count, size_t s, unsigned int t)
+	: Udjat::Abstract::Agent("files"), mount_point(mp), threads(t), largest(count), growing(count), tracked(s ? s : 1) {
+
+	seen.reserve(tracked);
+
+	Object::properties.icon = "document-open-recent";
+	Object::properties.label = _( "Largest files" );
+
+	// The first refresh seeds the rankings, later ones only verify them.
+	update.timer = 60;
+
+ }
+
+ struct FilesAgent::Seed {
+
+	/// @brief Protects the ranking and the owner.
+	std::mutex guard;
+
+	/// @brief The agent to publish to, nullptr after it was destroyed.
+	FilesAgent *owner;
+
+	/// @brief Largest files found by the walk.
+	Udjat::Ranking<ino_t,File> largest;
+
+	Seed(FilesAgent *o, size_t count) : owner(o), largest(count) {
+	}
+
+ };
+
+ FilesAgent::~FilesAgent() {
+	if(activity) {
+		Udjat::MainLoop::getInstance().remove(this);
+	}
+	if(seed) {
+		std::lock_guard<std::mutex> lock(seed->guard);
+		seed->owner = nullptr;
+	}
+ }
+
+ void FilesAgent::start() {
+
+	Udjat::Abstract::Agent::start();
+
+	if(activity) {
+		return;
+	}
+
+	try {
+
+		activity.reset(new Udjat::Activity(mount_point.c_str(),true));
+
+		Udjat::MainLoop::getInstance().insert(this,activity->descriptor(),Udjat::MainLoop::oninput,[this](const Udjat::MainLoop::Event) {
+			activity->drain([this](int fd){
+				changed(fd);
+			});
+			return true;
+		});
+
+	} catch(const std::exception &e) {
+
+		activity.reset();
+		warning() << "Can't watch file changes (" << e.what() << "), rankings will be updated on rescan only" << endl;
+
+	}
+
+ }
+
+ void FilesAgent::changed(int fd) {
+
+	struct stat st;
+	if(fstat(fd,&st) || !S_ISREG(st.st_mode)) {
+		return;
+	}
+
+	double now = monotonic();
+	uint64_t size = (uint64_t) st.st_size;
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	// Path is resolved only for files entering (or already in) a ranking.
+	File file;
+	auto resolve = [fd,&file,size]() {
+		if(file.path.empty()) {
+			char link[32];
+			char path[PATH_MAX+1];
+			snprintf(link,sizeof(link),"/proc/self/fd/%d",fd);
+			ssize_t length = readlink(link,path,PATH_MAX);
+			if(length <= 0) {
+				return false;
+			}
+			file.path.assign(path,length);
+			file.size = size;
+		}
+		return true;
+	};
+
+	// Growth since the previous observation (at least 1 second apart).
+	auto previous = seen.find(st.st_ino);
+	if(previous == seen.end()) {
+
+		if(seen.size() >= tracked) {
+			// Forget the file unchanged for the longest time.
+			seen.erase(recent.back());
+			recent.pop_back();
+		}
+		recent.push_front(st.st_ino);
+		seen.emplace(st.st_ino,Seen{size,now,recent.begin()});
+
+	} else {
+
+		recent.splice(recent.begin(),recent,previous->second.position);
+
+		if(now - previous->second.time >= 1) {
+
+			double rate = ((double) size - (double) previous->second.size) / (now - previous->second.time);
+			previous->second.size = size;
+			previous->second.time = now;
+
+			if(rate <= 0) {
+				growing.erase(st.st_ino);
+			} else if((growing.contains(st.st_ino) || growing.accepts(rate)) && resolve()) {
+				growing.set(st.st_ino,rate,file);
+			}
+
+		}
+
+	}
+
+	if((largest.contains(st.st_ino) || largest.accepts((double) size)) && resolve()) {
+		largest.set(st.st_ino,(double) size,file);
+	}
+
+ }
+
+ void FilesAgent::verify() {
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	for(auto ranking : { &largest, &growing }) {
+		for(const auto &item : ranking->sorted()) {
+			struct stat st;
+			if(lstat(item.data.path.c_str(),&st) || st.st_ino != item.key) {
+				ranking->erase(item.key);
+			}
+		}
+	}
+
+ }
+
+ bool FilesAgent::refresh() {
+
+	if(seeded) {
+		verify();
+		return true;
+	}
+
+	// The walk can take minutes on large filesystems, keep it off the refresh thread.
+	seeded = true;
+	seed = make_shared<Seed>(this,largest.capacity());
+
+	std::thread([](std::shared_ptr<Seed> seed, std::string path, unsigned int threads){
+
+		Udjat::DiskUsage walker{threads};
+		std::string failure;
+
+		try {
+
+			walker.walk(path.c_str(),[&seed](const std::string &filename, const struct statx &st){
+				std::lock_guard<std::mutex> lock(seed->guard);
+				if(seed->largest.accepts((double) st.stx_size)) {
+					seed->largest.set((ino_t) st.stx_ino,(double) st.stx_size,File{filename,st.stx_size});
+				}
+			});
+
+		} catch(const std::exception &e) {
+
+			failure = e.what();
+
+		}
+
+		std::lock_guard<std::mutex> lock(seed->guard);
+
+		FilesAgent *agent = seed->owner;
+		if(!agent) {
+			return;
+		}
+
+		if(!failure.empty()) {
+			agent->error() << "Can't walk " << path << ": " << failure << endl;
+		}
+
+		{
+			// Files already ranked from fanotify events are newer than the walk.
+			std::lock_guard<std::mutex> lock(agent->guard);
+			for(const auto &item : seed->largest.sorted()) {
+				if(!agent->largest.contains(item.key) && agent->largest.accepts(item.score)) {
+					agent->largest.set(item.key,item.score,item.data);
+				}
+			}
+		}
+		seed->largest.clear();
+
+		agent->info()	<< walker.stats().directories << " directories on " << path
+						<< " walked for the largest files" << endl;
+
+	},seed,mount_point,threads).detach();
+
+	return true;
+
+ }
+
+ void FilesAgent::report(Udjat::Value &value) const {
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	{
+		Udjat::Value &files = value["largest"];
+		for(const auto &item : largest.sorted()) {
+			Udjat::Value &file = files.append(Udjat::Value::Object);
+			file["path"] = item.data.path;
+			file["size"] = (unsigned long long) item.data.size;
+		}
+	}
+
+	{
+		Udjat::Value &files = value["growing"];
+		for(const auto &item : growing.sorted()) {
+			Udjat::Value &file = files.append(Udjat::Value::Object);
+			file["path"] = item.data.path;
+			file["size"] = (unsigned long long) item.data.size;
+			file["rate"] = item.score;		// bytes/second
+		}
+	}
+
+ }
+
+ void FilesAgent::get(const Udjat::Request &request, Udjat::Response &response) {
+	Udjat::Abstract::Agent::get(request,response);
+	report(response);
+ }
+
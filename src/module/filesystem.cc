@@ -17,43 +17,347 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+
  #include <config.h>
  #include <sys/stat.h>
  #include <fcntl.h>
  #include <udjat/filesystem.h>
+ #include <udjat/backend.h>
+ #include <udjat/instrumentation.h>
  #include <system_error>
  #include <unistd.h>
  #include <sys/statvfs.h>
  #include <iostream>
+ #include <atomic>
+ #include <mutex>
+ #include <condition_variable>
+ #include <functional>
+ #include <thread>
+ #include <chrono>
+ #include <list>
+ #include <string>
 
  using namespace std;
 
  namespace Udjat {
 
-	 FileSystem::FileSystem(const char *path) {
+	/// @brief Mount table revision, incremented on every mount/umount.
+	static std::atomic<unsigned int> mount_revision{0};
+
+	struct FileSystem::Context {
+
+		/// @brief Path to the mount point (owned, a pending sample can outlive the agent).
+		std::string path;
+
+		/// @brief Handle for the disk device (O_PATH when available).
+		int handle = -1;
+
+		/// @brief Mount table revision when the handle was opened.
+		unsigned int revision = 0;
+
+		std::mutex guard;
+		std::condition_variable changed;
+
+		/// @brief Is there a sample running?
+		bool busy = false;
+
+		/// @brief Result of the last sample.
+		Stats result;
+		int error = 0;
+
+		Context(const char *p) : path(p) {
+		}
+
+		~Context() {
+			if(handle >= 0) {
+				::close(handle);
+			}
+		}
+
+		/// @brief Open (or reopen) the handle for the mount point.
+		/// @return 0 or errno.
+		int open() noexcept;
+
+		/// @brief Get statistics from the active backend.
+		/// @return 0 or errno.
+		int sample(Stats &stats) noexcept;
+
+		/// @brief Get statistics, reopening the mount point if needed.
+		/// @return 0 or errno.
+		int live(Stats &stats) noexcept;
+
+	};
+
+	/// @brief Small pool of sampling threads.
+	/// @details Grows whenever no thread is idle, so threads blocked on hung mounts
+	/// never delay the healthy ones (a mount has at most one pending sample, so the
+	/// pool is bounded by the hung mounts plus the ones being sampled); idle threads
+	/// above 'keep' exit. 'limit' is only a safety net: at the limit with no idle
+	/// thread the job is refused instead of queued behind the blocked ones.
+	class Pool {
+	private:
+		static const size_t keep = 2;
+		static const size_t limit = 1024;
+
+		std::mutex guard;
+		std::condition_variable wake;
+		std::list<std::function<void()>> jobs;
+		size_t threads = 0;
+		size_t idle = 0;
+
+		void run() {
+
+			std::unique_lock<std::mutex> lock(guard);
+
+			for(;;) {
+
+				if(jobs.empty()) {
+					idle++;
+					bool ready = wake.wait_for(lock,std::chrono::seconds(60),[this]{ return !jobs.empty(); });
+					idle--;
+					if(!ready && threads > keep) {
+						break;
+					}
+					continue;
+				}
+
+				auto job = std::move(jobs.front());
+				jobs.pop_front();
+
+				lock.unlock();
+				job();
+				lock.lock();
+
+			}
+
+			threads--;
+
+		}
+
+	public:
+
+		static Pool & getInstance() {
+			// Never destroyed, blocked threads can outlive the module.
+			static Pool *instance = new Pool();
+			return *instance;
+		}
+
+		/// @brief Run job on a pool thread.
+		/// @return false if every thread is blocked and the pool is at its limit.
+		bool push(std::function<void()> job) {
+
+			std::lock_guard<std::mutex> lock(guard);
+
+			if(idle <= jobs.size()) {
+				if(threads >= limit) {
+					return false;
+				}
+				// Counted only once started, std::thread throws if it can't create one
+				// (the worker needs the guard, it can't exit before the increment).
+				std::thread worker{[this]{ run(); }};
+				threads++;
+				worker.detach();
+			}
+
+			jobs.push_back(std::move(job));
+			wake.notify_one();
+			return true;
+
+		}
+
+	};
+
+	FileSystem::Timeout::Timeout(const char *path) : std::system_error(ETIMEDOUT,std::system_category(),path) {
+	}
+
+	FileSystem::FileSystem(const char *path, unsigned int t) : context(make_shared<Context>(path)), timeout(t) {
+	}
+
+	FileSystem::~FileSystem() {
+		// A pending sample keeps its own reference to the context.
+	}
+
+	void FileSystem::remounted() noexcept {
+		mount_revision++;
+	}
+
+	int FileSystem::Context::open() noexcept {
+
+		revision = mount_revision;
+
+#ifdef HAVE_INSTRUMENTATION
+		Instrumentation::syscalls().open++;
+#endif // HAVE_INSTRUMENTATION
+
+		if(handle >= 0) {
+			::close(handle);
+			handle = -1;
+		}
+
+#ifdef O_PATH
+		// fstatvfs() works on O_PATH handles since linux 3.12; no read access needed.
+		handle = ::open(path.c_str(),O_PATH|O_DIRECTORY|O_CLOEXEC);
+		if(handle < 0 && errno == EINVAL) {
+			handle = ::open(path.c_str(),O_RDONLY|O_CLOEXEC);
+		}
+#else
+		handle = ::open(path.c_str(),O_RDONLY|O_CLOEXEC);
+#endif // O_PATH
+
+		return (handle < 0 ? errno : 0);
 
-		handle = open(path,O_RDONLY);
-		if(handle < 0) {
-			throw system_error(ENOENT,system_category(),"Can't open filesystem");
+	}
+
+	int FileSystem::Context::sample(Stats &stats) noexcept {
+
+		try {
+			return Backend::getInstance().stats(path.c_str(),stats,[this](Stats &stats){
+				return live(stats);
+			});
+		} catch(const std::system_error &e) {
+			return e.code().value();
+		} catch(...) {
+			return EIO;
 		}
-	 }
 
-	 FileSystem::~FileSystem() {
-		::close(handle);
-	 }
+	}
 
-	 float FileSystem::used() const {
+	int FileSystem::Context::live(Stats &stats) noexcept {
 
 		struct statvfs info;
 
+		if(revision != mount_revision || handle < 0) {
+			// Mount table has changed, the handle can point to an old (detached) filesystem.
+			int rc = open();
+			if(rc) {
+				return rc;
+			}
+		}
+
 		// statfs or statvfs? That's the question.
 
+#ifdef HAVE_INSTRUMENTATION
+		Instrumentation::syscalls().statvfs++;
+#endif // HAVE_INSTRUMENTATION
+
 		if(fstatvfs(handle,&info) < 0) {
-			throw system_error(errno,system_category(),"Can't get file system statistics");
+
+			switch(errno) {
+			case ESTALE:
+			case ENOTCONN:
+			case ENODEV:
+			case EIO:
+				// Stale handle, reopen and try again.
+				if(open()) {
+					return errno;
+				}
+				if(fstatvfs(handle,&info) == 0) {
+					break;
+				}
+				return errno;
+
+			default:
+				return errno;
+			}
+
+		}
+
+		// Block counts are in f_frsize units, not f_bsize.
+		uint64_t frsize = (info.f_frsize ? info.f_frsize : info.f_bsize);
+
+		stats.total = ((uint64_t) info.f_blocks) * frsize;
+		stats.free = ((uint64_t) info.f_bfree) * frsize;
+		stats.available = ((uint64_t) info.f_bavail) * frsize;
+		stats.inodes = info.f_files;
+		stats.ifree = info.f_ffree;
+
+		return 0;
+
+	}
+
+	bool FileSystem::unresponsive() const noexcept {
+		std::lock_guard<std::mutex> lock(context->guard);
+		return context->busy;
+	}
+
+	FileSystem::Stats FileSystem::stats() {
+
+		Stats stats;
+
+		if(!timeout) {
+
+			// No time limit, run in the caller's thread.
+			int rc = context->sample(stats);
+			if(rc) {
+				throw system_error(rc,system_category(),context->path.c_str());
+			}
+			return stats;
+
+		}
+
+		std::unique_lock<std::mutex> lock(context->guard);
+
+		if(context->busy) {
+			// Previous sample is still blocked, don't pile up another thread.
+			throw Timeout(context->path.c_str());
+		}
+
+		std::shared_ptr<Context> ctx{context};
+		bool queued = Pool::getInstance().push([ctx]{
+
+			Stats stats;
+			int rc = ctx->sample(stats);
+
+			std::lock_guard<std::mutex> lock(ctx->guard);
+			ctx->result = stats;
+			ctx->error = rc;
+			ctx->busy = false;
+			ctx->changed.notify_all();
+
+		});
+
+		if(!queued) {
+			// Every sampling thread is blocked on a hung mount, fail now instead of waiting behind them.
+			throw Timeout(context->path.c_str());
+		}
+
+		// The job can't clear it before we wait, it needs the context lock.
+		context->busy = true;
+
+		if(!context->changed.wait_for(lock,std::chrono::milliseconds(timeout),[this]{ return !context->busy; })) {
+			throw Timeout(context->path.c_str());
+		}
+
+		if(context->error) {
+			throw system_error(context->error,system_category(),context->path.c_str());
+		}
+
+		return context->result;
+
+	}
+
+	float FileSystem::Stats::used() const noexcept {
+
+		// Same as df: the blocks reserved for root are not available.
+		uint64_t used = total - free;
+		uint64_t size = used + available;
+
+		if(!size) {
+			return 0;
+		}
+
+		return ((float) used) / ((float) size);
+
+	}
+
+	float FileSystem::Stats::iused() const noexcept {
+
+		if(!inodes) {
+			return 0;
 		}
 
-		return ((float) (info.f_blocks - info.f_bfree)) / ((float) (info.f_blocks));
+		return ((float) (inodes - ifree)) / ((float) inodes);
 
-	 }
+	}
 
  }
@@ -22,219 +22,162 @@
  #include <udjat/module.h>
  #include <udjat/moduleinfo.h>
  #include <udjat/factory.h>
- #include <blkid/blkid.h>
- #include <udjat/agent.h>
+ #include <udjat/worker.h>
+ #include <udjat/instrumentation.h>
+ #include <udjat/tools/quark.h>
  #include <unistd.h>
  #include <agent.h>
- #include <fstream>
- #include <vector>
- #include <udjat/tools/file.h>
- #include <udjat/tools/xml.h>
- #include <udjat/tools/intl.h>
+ #include <container.h>
+ #include <io.h>
+ #include <usage.h>
+ #include <quotas.h>
+ #include <pressure.h>
+ #include <cgroups.h>
+ #include <writeback.h>
+ #include <queues.h>
+ #include <udjat/mountinfo.h>
+ #include <udjat/backend.h>
+ #include <stdexcept>
  #include <udjat/tools/logger.h>
 
  using namespace std;
 
  static const Udjat::ModuleInfo moduleinfo{"Logical disk status monitor"};
 
- class Module : public Udjat::Module, Udjat::Factory {
+#ifdef HAVE_INSTRUMENTATION
+ /// @brief Expose the disk agents instrumentation (/api/1.0/storage).
+ class Worker : public Udjat::Worker {
  public:
+	Worker() : Udjat::Worker("storage",moduleinfo) {
+	}
 
- 	Module() : Udjat::Module("disk",moduleinfo), Udjat::Factory("storage",moduleinfo) {
- 	};
-
- 	virtual ~Module() {
- 	}
-
-	std::shared_ptr<Udjat::Abstract::Agent> AgentFactory(const Udjat::Abstract::Object UDJAT_UNUSED(&parent), const pugi::xml_node &node) const override {
-
-		/// @brief Container with all disks
-		class Container : public Udjat::Abstract::Agent {
-		public:
-			Container(const pugi::xml_node &node) : Udjat::Abstract::Agent("storage") {
+	bool get(Udjat::Request UDJAT_UNUSED(&request), Udjat::Response &response) const override {
 
-				Object::properties.icon = "drive-multidisk";
-				Object::properties.label = _( "Logical disks" );
-
-				//
-				// Load devices.
-				//
-				struct List {
+		Udjat::Instrumentation::syscalls().get(response["syscalls"]);
 
-					struct Device {
-						string devname;
-						string label;
-						string mountpoint;
-						string type;
+		Udjat::Value &agents = response["agents"];
+		Udjat::Instrumentation::for_each([&agents](const char *name, const Udjat::Instrumentation::Refresh &refresh){
+			Udjat::Value &agent = agents.append(Udjat::Value::Object);
+			agent["mp"] = name;
+			refresh.get(agent);
+		});
 
-						Device(const char *d, const string &l, const string &t) : devname(d),label(l),type(t) {
-						}
+		return true;
+	}
 
-					};
+ };
+#endif // HAVE_INSTRUMENTATION
 
-					std::vector<Device> values;
+ class Module : public Udjat::Module, Udjat::Factory {
+ private:
+#ifdef HAVE_INSTRUMENTATION
+	Worker worker;
+#endif // HAVE_INSTRUMENTATION
 
-					inline std::vector<Device>::iterator begin() {
-						return values.begin();
-					}
+ public:
 
-					inline std::vector<Device>::iterator end() {
-						return values.end();
-					}
-
-				};
-
-				List devices;
-
-				//
-				// Get block devices with labels.
-				//
-				{
-					blkid_cache cache = NULL;
+ 	Module() : Udjat::Module("disk",moduleinfo), Udjat::Factory("storage",moduleinfo) {
+ 	};
 
-					blkid_get_cache(&cache,NULL);
-					blkid_probe_all(cache);
-					blkid_dev_iterate iter = blkid_dev_iterate_begin(cache);
-					blkid_dev dev;
-					while (blkid_dev_next(iter, &dev) == 0) {
+ 	virtual ~Module() {
+ 	}
 
-						dev = blkid_verify(cache, dev);
-						if (!dev)
-							continue;
+	std::shared_ptr<Udjat::Abstract::Agent> AgentFactory(const Udjat::Abstract::Object UDJAT_UNUSED(&parent), const pugi::xml_node &node) const override {
 
-						string label;
-						string type;
+		const char * mountpoint = node.attribute("mount-point").as_string();
 
-						blkid_tag_iterate tag = blkid_tag_iterate_begin(dev);
-						const char *t, *value;
-						while (blkid_tag_next(tag, &t, &value) == 0) {
+		if(!strcasecmp(node.attribute("type").as_string(),"io")) {
 
-							if(!strcasecmp(t,"LABEL")) {
-								label = value;
-								info() << "Detected device '" << blkid_dev_devname(dev) << "' with name '" << label << "'" << endl;
-							} else if(!strcasecmp(t,"TYPE")) {
-								type = value;
-							}
+			// I/O statistics for the device behind the mount point.
+			Udjat::MountInfo mounts;
+			Udjat::Backend::getInstance().mountinfo(mounts,-1);
+			const Udjat::MountInfo::Entry *entry = mounts.find(*mountpoint ? mountpoint : "/");
+			if(!entry || !entry->device) {
+				throw runtime_error(string{"Can't find block device for '"} + mountpoint + "'");
+			}
 
-						}
-						blkid_tag_iterate_end(tag);
-						devices.values.emplace_back(blkid_dev_devname(dev),label,type);
+			return make_shared<IOAgent>(entry->device,Udjat::Quark(node.attribute("name").as_string("io")).c_str());
 
-					}
+		}
 
-					blkid_dev_iterate_end(iter);
+		if(!strcasecmp(node.attribute("type").as_string(),"cgroups")) {
 
-					blkid_put_cache(cache);
+			// Per-cgroup throughput, with its own view of the mount table.
+			Udjat::MountInfo mounts;
+			Udjat::Backend::getInstance().mountinfo(mounts,-1);
 
-				}
+			auto agent = make_shared<CGroups>(node.attribute("path").as_string("/"),node);
+			agent->set(mounts);
+			return agent;
 
-				// Get mount points
-				{
-					Udjat::File::Text mounts("/proc/mounts");
+		}
 
-					for(auto device = devices.begin(); device != devices.end(); device++) {
+		if(!strcasecmp(node.attribute("type").as_string(),"writeback")) {
 
-						const char *devname = device->devname.c_str();
-						size_t szName = device->devname.size();
+			// Dirty pages and writeback, with its own view of the mount table.
+			Udjat::MountInfo mounts;
+			Udjat::Backend::getInstance().mountinfo(mounts,-1);
 
-						for(auto mp : mounts) {
-							if(!strncmp(devname,mp->c_str(),szName)) {
-								const char *from = mp->c_str()+szName;
-								while(*from && isspace(*from))
-									from++;
-								const char *to = from;
-								while(*to && !isspace(*to)) {
-									to++;
-								}
-								if(*to) {
-									device->mountpoint = string(from,to-from);
-									info()	<< "Using " << device->mountpoint
-											<< " as mount point for " << device->devname
-											<< " (" << device->label << ")"
-											<< endl;
-									break;
-								}
-							}
-						}
+			auto agent = make_shared<WritebackAgent>(Udjat::Quark(node.attribute("name").as_string("writeback")).c_str(),node);
+			agent->set(mounts);
+			return agent;
 
-					}
-				}
+		}
 
-				// Create agents
-				{
+		if(!strcasecmp(node.attribute("type").as_string(),"queues")) {
 
-					for(auto device = devices.begin(); device != devices.end(); device++) {
+			// Block queue advisor, with its own view of the mount table.
+			Udjat::MountInfo mounts;
+			Udjat::Backend::getInstance().mountinfo(mounts,-1);
 
-						if(device->mountpoint.empty()) {
-							continue;
-						}
+			auto agent = make_shared<QueueAgent>(Udjat::Quark(node.attribute("name").as_string("queues")).c_str(),node);
+			agent->set(mounts);
+			return agent;
 
-						// Check for ignore-[type] attribute
-						if(Udjat::Attribute(node,(string{"ignore-"} + device->type).c_str()).as_bool(false)) {
-							info() << "Ignoring '" << device->mountpoint << "'" << endl;
-							continue;
-						}
+		}
 
-						{
-							std::shared_ptr<Udjat::Abstract::Agent> child{
-								std::make_shared<::Agent>(
-									Udjat::Quark(device->mountpoint).c_str(),
-									Udjat::Quark(device->label).c_str(),
-									node
-								)
-							};
+		if(!strcasecmp(node.attribute("type").as_string(),"pressure")) {
 
-							Udjat::Abstract::Agent::push_back(child);
-						}
-
-					}
-
-				}
+			// I/O stall information, system wide or for a cgroup.
+			return make_shared<PressureAgent>(Udjat::Quark(node.attribute("name").as_string("pressure")).c_str(),node);
 
+		}
 
-			}
+		if(!strcasecmp(node.attribute("type").as_string(),"quota")) {
 
-			virtual ~Container() {
+			// User, group and project quotas of the filesystem behind the mount point.
+			Udjat::MountInfo mounts;
+			Udjat::Backend::getInstance().mountinfo(mounts,-1);
+			const Udjat::MountInfo::Entry *entry = mounts.find(*mountpoint ? mountpoint : "/");
+			if(!entry) {
+				throw runtime_error(string{"Can't find filesystem for '"} + mountpoint + "'");
 			}
 
-			/// @brief Export info.
-			void get(const Udjat::Request &request, Udjat::Response &response) override {
+			return make_shared<QuotaAgent>(
+						Udjat::Quark(entry->mount_point).c_str(),
+						entry->source.c_str(),
+						Udjat::Quark(node.attribute("name").as_string("quota")).c_str(),
+						node
+					);
 
-				Udjat::Abstract::Agent::get(request,response);
-
-				Udjat::Value &devices = response["disks"];
-
-				for(auto child : *this) {
-
-					auto agent = dynamic_cast<::Agent *>(child.get());
-					if(!agent)
-						continue;
-
-					// It's a 'smart' agent, export it.
-					Udjat::Value &device = devices.append(Udjat::Value::Object);
-
-					auto state = agent->state();
-
-					device["name"] = agent->name();
-					device["summary"] = agent->summary();
-					device["icon"] = agent->icon();
-					device["state"] = state->summary();
-					device["level"] = std::to_string(state->level());
-					device["used"] = agent->to_string();
-					device["mp"] = agent->getMountPoint();
+		}
 
-				}
+		if(!strcasecmp(node.attribute("type").as_string(),"du")) {
 
+			// Size of the top-level subdirectories.
+			const char *path = node.attribute("path").as_string(mountpoint);
+			if(!*path) {
+				throw runtime_error("Required attribute 'path' is missing");
 			}
 
-		};
+			return make_shared<UsageAgent>(Udjat::Quark(path).c_str(),Udjat::Quark(node.attribute("name").as_string("du")).c_str(),node);
 
-		const char * mountpoint = node.attribute("mount-point").as_string();
+		}
 
 		if(*mountpoint) {
 
 			// Has device name, create a device node.
-			return make_shared<Agent>(Udjat::Quark(mountpoint).c_str(),"",node);
+			return make_shared<Agent>(mountpoint,"",node);
 
 		}
 
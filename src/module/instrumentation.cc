@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/instrumentation.h>
+
+#ifdef HAVE_INSTRUMENTATION
+
+ #include <mutex>
+ #include <list>
+ #include <ctime>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	namespace Instrumentation {
+
+		static std::mutex guard;
+
+		static std::list<std::pair<const char *, const Refresh *>> & registry() {
+			static std::list<std::pair<const char *, const Refresh *>> agents;
+			return agents;
+		}
+
+		uint64_t now() noexcept {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC,&ts);
+			return (((uint64_t) ts.tv_sec) * 1000000) + (((uint64_t) ts.tv_nsec) / 1000);
+		}
+
+		Histogram::Histogram() {
+			for(size_t ix = 0; ix < buckets; ix++) {
+				counts[ix] = 0;
+			}
+		}
+
+		void Histogram::push(uint64_t us) noexcept {
+
+			size_t bucket = 0;
+			if(us) {
+				bucket = (size_t) (63 - __builtin_clzll(us));
+				if(bucket >= buckets) {
+					bucket = buckets-1;
+				}
+			}
+
+			counts[bucket]++;
+			total++;
+			sum += us;
+
+			uint64_t current = max;
+			while(us > current && !max.compare_exchange_weak(current,us)) {
+			}
+
+		}
+
+		void Histogram::get(Udjat::Value &value) const {
+
+			uint64_t samples = total;
+
+			value["samples"] = (unsigned long long) samples;
+			value["max"] = (unsigned long long) max.load();
+			value["average"] = (unsigned long long) (samples ? (sum / samples) : 0);
+
+			// Only non empty buckets, labeled by the upper bound in us.
+			Udjat::Value &values = value["buckets"];
+			for(size_t ix = 0; ix < buckets; ix++) {
+				uint32_t count = counts[ix];
+				if(count) {
+					Udjat::Value &bucket = values.append(Udjat::Value::Object);
+					bucket["le"] = (unsigned long long) (((uint64_t) 2) << ix);
+					bucket["count"] = (unsigned int) count;
+				}
+			}
+
+		}
+
+		void Refresh::get(Udjat::Value &value) const {
+
+			latency.get(value["latency"]);
+			value["errors"] = (unsigned long long) errors.load();
+			value["timeouts"] = (unsigned long long) timeouts.load();
+
+			uint64_t sampled = last;
+			if(sampled) {
+				value["age"] = (unsigned long long) ((now() - sampled) / 1000000);	// seconds
+			}
+
+		}
+
+		void Syscalls::get(Udjat::Value &value) const {
+			value["open"] = (unsigned long long) open.load();
+			value["statvfs"] = (unsigned long long) statvfs.load();
+			value["mountinfo"] = (unsigned long long) mountinfo.load();
+			value["diskstats"] = (unsigned long long) diskstats.load();
+		}
+
+		Syscalls & syscalls() noexcept {
+			static Syscalls counters;
+			return counters;
+		}
+
+		void insert(const char *name, const Refresh &refresh) {
+			std::lock_guard<std::mutex> lock(guard);
+			registry().emplace_back(name,&refresh);
+		}
+
+		void remove(const Refresh &refresh) noexcept {
+			std::lock_guard<std::mutex> lock(guard);
+			registry().remove_if([&refresh](const std::pair<const char *, const Refresh *> &item){
+				return item.second == &refresh;
+			});
+		}
+
+		void for_each(const std::function<void(const char *name, const Refresh &refresh)> &call) {
+			std::lock_guard<std::mutex> lock(guard);
+			for(auto &item : registry()) {
+				call(item.first,*item.second);
+			}
+		}
+
+	}
+
+ }
+
+#endif // HAVE_INSTRUMENTATION
@@ -0,0 +1,203 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <io.h>
+ #include <udjat/tools/quark.h>
+ #include <udjat/tools/intl.h>
+ #include <stdexcept>
+ #include <sstream>
+ #include <iomanip>
+
+ using namespace std;
+
+ static const struct MetricDef {
+	const char *name;
+	const char *label;
+	const char *unit;
+
+	struct {
+		float from;
+		float to;
+		const char 						* name;			///< @brief State name.
+		Udjat::Level					  level;		///< @brief State level.
+		const char						* summary;		///< @brief State summary.
+	} states[3];
+
+ } metricdefs[] = {
+	{
+		"iops",
+		N_( "I/O operations per second" ),
+		"",
+		{
+			{ 0.0, 1e12, "active", Udjat::unimportant, "" },
+		}
+	},
+	{
+		"read",
+		N_( "Bytes read per second" ),
+		"B/s",
+		{
+			{ 0.0, 1e15, "active", Udjat::unimportant, "" },
+		}
+	},
+	{
+		"write",
+		N_( "Bytes written per second" ),
+		"B/s",
+		{
+			{ 0.0, 1e15, "active", Udjat::unimportant, "" },
+		}
+	},
+	{
+		"await",
+		N_( "Average I/O wait" ),
+		"ms",
+		{
+			{ 0.0, 20.0, "good", Udjat::ready, N_( "${name} average wait is less than 20ms" ) },
+			{ 20.0, 100.0, "slow", Udjat::warning, N_( "${name} average wait is greater than 20ms" ) },
+			{ 100.0, 1e9, "stalled", Udjat::error, N_( "${name} average wait is greater than 100ms" ) },
+		}
+	},
+	{
+		"queue",
+		N_( "Average queue depth" ),
+		"",
+		{
+			{ 0.0, 1e9, "active", Udjat::unimportant, "" },
+		}
+	},
+	{
+		"util",
+		N_( "Device utilization" ),
+		"%",
+		{
+			{ 0.0, 70.0, "good", Udjat::ready, N_( "${name} utilization is less than 70%" ) },
+			{ 70.0, 90.0, "busy", Udjat::warning, N_( "${name} utilization is greater than 70%" ) },
+			{ 90.0, 101.0, "saturated", Udjat::error, N_( "${name} is saturated" ) },
+		}
+	}
+ };
+
+ class IOAgent::Metric : public Udjat::Agent<float> {
+ private:
+	const MetricDef &def;
+
+ public:
+	Metric(const MetricDef &d) : Udjat::Agent<float>(d.name), def(d) {
+#ifdef GETTEXT_PACKAGE
+		Object::properties.label = dgettext(GETTEXT_PACKAGE,def.label);
+#else
+		Object::properties.label = def.label;
+#endif // GETTEXT_PACKAGE
+	}
+
+	void start() override {
+
+		if(states.empty()) {
+
+			for(size_t ix = 0; ix < (sizeof(def.states)/ sizeof(def.states[0])) && def.states[ix].name; ix++) {
+
+				push_back(
+					make_shared<Udjat::State<float>>(
+						def.states[ix].name,
+						def.states[ix].from,
+						def.states[ix].to,
+						def.states[ix].level,
+#ifdef GETTEXT_PACKAGE
+						Udjat::Quark(expand(dgettext(GETTEXT_PACKAGE,def.states[ix].summary))).c_str(),
+#else
+						Udjat::Quark(expand(def.states[ix].summary)).c_str(),
+#endif
+						""
+					)
+				);
+
+			}
+
+		}
+
+		Udjat::Abstract::Agent::start();
+
+	}
+
+	std::string to_string() const noexcept override {
+		std::stringstream out;
+		out << std::fixed << std::setprecision(2) << get() << def.unit;
+		return out.str();
+	}
+
+ };
+
+ IOAgent::IOAgent(dev_t d, const char *name) : Udjat::Abstract::Agent(name), device(d) {
+
+	Object::properties.icon = "drive-harddisk";
+	Object::properties.label = _( "Disk I/O" );
+
+	for(size_t ix = 0; ix < (sizeof(metrics)/sizeof(metrics[0])); ix++) {
+		metrics[ix] = make_shared<Metric>(metricdefs[ix]);
+		Udjat::Abstract::Agent::push_back(metrics[ix]);
+	}
+
+ }
+
+ IOAgent::~IOAgent() {
+ }
+
+ bool IOAgent::refresh() {
+
+	Udjat::DiskStats::Counters current;
+
+	if(!Udjat::DiskStats::get(device,current)) {
+		throw runtime_error("Device is not in /proc/diskstats");
+	}
+
+	if(previous.timestamp) {
+
+		Udjat::DiskStats::Rates rates{previous,current};
+
+		metrics[0]->set(rates.iops);
+		metrics[1]->set(rates.read);
+		metrics[2]->set(rates.write);
+		metrics[3]->set(rates.await);
+		metrics[4]->set(rates.queue);
+		metrics[5]->set(rates.util);
+
+	}
+
+	previous = current;
+	return true;
+
+ }
+
+ Udjat::DiskStats::Rates IOAgent::rates() const noexcept {
+
+	Udjat::DiskStats::Rates rates;
+
+	rates.iops = metrics[0]->get();
+	rates.read = metrics[1]->get();
+	rates.write = metrics[2]->get();
+	rates.await = metrics[3]->get();
+	rates.queue = metrics[4]->get();
+	rates.util = metrics[5]->get();
+
+	return rates;
+
+ }
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/iostat.h>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <cstring>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/sysmacros.h>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	void IOStat::parse(const char *text, const std::function<void(dev_t dev, const Counters &counters)> &call) {
+
+		const char *ptr = text;
+
+		while(*ptr) {
+
+			char *end;
+			unsigned long major = strtoul(ptr,&end,10);
+			if(*end != ':') {
+				break;
+			}
+			unsigned long minor = strtoul(end+1,&end,10);
+
+			Counters counters;
+
+			// key=value pairs until the end of line.
+			ptr = end;
+			while(*ptr && *ptr != '\n') {
+
+				while(*ptr == ' ') {
+					ptr++;
+				}
+
+				const char *key = ptr;
+				const char *eq = strchr(key,'=');
+				if(!eq) {
+					break;
+				}
+
+				uint64_t value = strtoull(eq+1,&end,10);
+				size_t length = eq - key;
+
+				if(length == 6 && !strncmp(key,"rbytes",6)) {
+					counters.rbytes = value;
+				} else if(length == 6 && !strncmp(key,"wbytes",6)) {
+					counters.wbytes = value;
+				} else if(length == 4 && !strncmp(key,"rios",4)) {
+					counters.rios = value;
+				} else if(length == 4 && !strncmp(key,"wios",4)) {
+					counters.wios = value;
+				}
+
+				ptr = end;
+
+			}
+
+			call(makedev(major,minor),counters);
+
+			if(*ptr == '\n') {
+				ptr++;
+			}
+
+		}
+
+	}
+
+	dev_t IOStat::disk(dev_t dev) noexcept {
+
+		// /sys/dev/block/M:m/partition exists only for partitions, the disk is the parent directory.
+		char path[128];
+		snprintf(path,sizeof(path),"/sys/dev/block/%u:%u/partition",major(dev),minor(dev));
+		if(access(path,F_OK)) {
+			return dev;
+		}
+
+		snprintf(path,sizeof(path),"/sys/dev/block/%u:%u/../dev",major(dev),minor(dev));
+		int fd = open(path,O_RDONLY|O_CLOEXEC);
+		if(fd < 0) {
+			return dev;
+		}
+
+		char text[32];
+		ssize_t length = read(fd,text,sizeof(text)-1);
+		::close(fd);
+
+		unsigned int mj, mn;
+		if(length <= 0) {
+			return dev;
+		}
+		text[length] = 0;
+
+		if(sscanf(text,"%u:%u",&mj,&mn) != 2) {
+			return dev;
+		}
+
+		return makedev(mj,mn);
+
+	}
+
+ }
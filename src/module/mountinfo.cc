@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/mountinfo.h>
+ #include <sys/sysmacros.h>
+ #include <sys/stat.h>
+ #include <system_error>
+ #include <unistd.h>
+ #include <fcntl.h>
+ #include <cstring>
+ #include <cstdlib>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	/// @brief Get next space separated field, expanding octal escapes (\040).
+	static const char * field(const char *ptr, std::string &value) {
+
+		value.clear();
+
+		while(*ptr == ' ') {
+			ptr++;
+		}
+
+		while(*ptr && *ptr != ' ' && *ptr != '\n') {
+
+			if(*ptr == '\\' && ptr[1] >= '0' && ptr[1] <= '7' && ptr[2] && ptr[3]) {
+				value += (char) (((ptr[1]-'0') << 6) | ((ptr[2]-'0') << 3) | (ptr[3]-'0'));
+				ptr += 4;
+			} else {
+				value += *(ptr++);
+			}
+
+		}
+
+		return ptr;
+	}
+
+	MountInfo::MountInfo(const char *filename) {
+
+		int fd = open(filename,O_RDONLY|O_CLOEXEC);
+		if(fd < 0) {
+			throw system_error(errno,system_category(),filename);
+		}
+
+		try {
+			load(fd);
+		} catch(...) {
+			::close(fd);
+			throw;
+		}
+
+		::close(fd);
+	}
+
+	void MountInfo::load(int fd) {
+
+		string text;
+		char buffer[4096];
+
+		if(lseek(fd,0,SEEK_SET) < 0) {
+			throw system_error(errno,system_category(),"Can't rewind mount table");
+		}
+
+		ssize_t bytes;
+		while((bytes = read(fd,buffer,sizeof(buffer))) > 0) {
+			text.append(buffer,bytes);
+		}
+
+		if(bytes < 0) {
+			throw system_error(errno,system_category(),"Can't read mount table");
+		}
+
+		parse(text.c_str());
+
+	}
+
+	void MountInfo::parse(const char *text) {
+
+		entries.clear();
+		index.clear();
+		points.clear();
+
+		string value;
+
+		while(*text) {
+
+			// 36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+			Entry entry;
+			char *ptr;
+
+			entry.id = (unsigned int) strtoul(text,&ptr,10);
+			strtoul(ptr,&ptr,10);	// Parent ID.
+
+			unsigned int major = (unsigned int) strtoul(ptr,&ptr,10);
+			unsigned int minor = (*ptr == ':' ? (unsigned int) strtoul(ptr+1,&ptr,10) : 0);
+			entry.dev = makedev(major,minor);
+
+			const char *next = field(ptr,entry.root);
+			next = field(next,entry.mount_point);
+
+			// Skip mount options and the optional fields up to the separator.
+			const char *sep = strstr(next," - ");
+			const char *eol = strchr(next,'\n');
+
+			if(sep && (!eol || sep < eol)) {
+				next = field(sep+3,entry.type);
+				next = field(next,entry.source);
+				if(!entry.mount_point.empty()) {
+
+					if(entry.source[0] == '/') {
+						if(major) {
+							// The mount's device is the block device (also for /dev/root or sources in other namespaces).
+							entry.device = entry.dev;
+						} else {
+							// Anonymous device (btrfs subvolumes and the like), ask the source.
+							struct stat st;
+							if(!stat(entry.source.c_str(),&st) && S_ISBLK(st.st_mode)) {
+								entry.device = st.st_rdev;
+							}
+						}
+					}
+
+					if(entry.device) {
+						auto it = index.find(entry.device);
+						if(it == index.end()) {
+							index[entry.device] = entries.size();
+						} else if(entry.root == "/" && entries[it->second].root != "/") {
+							it->second = entries.size();
+						}
+					}
+
+					// Stacked mounts: the last one is the visible one.
+					points[entry.mount_point] = entries.size();
+
+					entries.push_back(std::move(entry));
+				}
+			}
+
+			if(!eol) {
+				break;
+			}
+			text = eol+1;
+
+		}
+
+	}
+
+	const MountInfo::Entry * MountInfo::find(const char *mount_point) const noexcept {
+
+		auto it = points.find(mount_point);
+		if(it == points.end()) {
+			return nullptr;
+		}
+
+		return &entries[it->second];
+
+	}
+
+	const MountInfo::Entry * MountInfo::find(dev_t device) const noexcept {
+
+		auto it = index.find(device);
+		if(it == index.end()) {
+			return nullptr;
+		}
+
+		return &entries[it->second];
+
+	}
+
+ }
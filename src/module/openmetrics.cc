@@ -0,0 +1,226 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <openmetrics.h>
+ #include <cstdio>
+ #include <cstring>
+
+ using namespace std;
+
+ /// @brief Exported metrics, in output order.
+ static const struct Metric {
+	const char *name;
+	const char *help;
+	bool io;			///< @brief From the I/O agent (only for disks with io-stats).
+	bool integer;		///< @brief Format as integer.
+ } metrics[] = {
+	{ "udjat_disk_usage_ratio",					"Disk usage (0 - 1), as reported by df",			false,	false	},
+	{ "udjat_disk_state_level",					"Level of the current disk state",					false,	true	},
+	{ "udjat_disk_size_bytes",					"Size of the filesystem",							false,	true	},
+	{ "udjat_disk_free_bytes",					"Free bytes, including the blocks reserved for root",	false,	true	},
+	{ "udjat_disk_available_bytes",				"Bytes available to unprivileged users",			false,	true	},
+	{ "udjat_disk_inodes",						"Total inodes",										false,	true	},
+	{ "udjat_disk_inodes_free",					"Free inodes",										false,	true	},
+	{ "udjat_disk_io_operations_per_second",	"I/O operations per second",						true,	false	},
+	{ "udjat_disk_io_read_bytes_per_second",	"Bytes read per second",							true,	false	},
+	{ "udjat_disk_io_write_bytes_per_second",	"Bytes written per second",							true,	false	},
+	{ "udjat_disk_io_await_seconds",			"Average time per I/O",								true,	false	},
+	{ "udjat_disk_io_queue_depth",				"Average queue depth",								true,	false	},
+	{ "udjat_disk_io_utilization_ratio",		"Fraction of time the device was busy",				true,	false	},
+ };
+
+ static constexpr size_t metric_count = sizeof(metrics)/sizeof(metrics[0]);
+
+ /// @brief Append label value, escaped as required by the text format.
+ static void escape(std::string &str, const char *value) {
+	for(const char *ptr = value; *ptr; ptr++) {
+		switch(*ptr) {
+		case '\\':
+			str += "\\\\";
+			break;
+		case '"':
+			str += "\\\"";
+			break;
+		case '\n':
+			str += "\\n";
+			break;
+		default:
+			str += *ptr;
+		}
+	}
+ }
+
+ OpenMetrics::OpenMetrics() {
+ }
+
+ OpenMetrics::~OpenMetrics() {
+ }
+
+ void OpenMetrics::insert(std::shared_ptr<::Agent> agent, std::shared_ptr<IOAgent> io) {
+
+	Disk disk;
+	disk.agent = agent;
+	disk.io = io;
+
+	const ::Agent::Metadata &metadata = agent->metadata();
+
+	disk.labels = "{mountpoint=\"";
+	escape(disk.labels,metadata.mount_point.c_str());
+	disk.labels += "\",device=\"";
+	escape(disk.labels,metadata.device.c_str());
+	disk.labels += "\",fstype=\"";
+	escape(disk.labels,metadata.type.c_str());
+	disk.labels += "\",label=\"";
+	escape(disk.labels,metadata.label.c_str());
+	disk.labels += "\"} ";
+
+	std::lock_guard<std::mutex> lock(guard);
+	disks.push_back(std::move(disk));
+	dirty = true;
+
+ }
+
+ void OpenMetrics::remove(const ::Agent *agent) {
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	for(auto disk = disks.begin(); disk != disks.end(); disk++) {
+		if(disk->agent.get() == agent) {
+			disks.erase(disk);
+			dirty = true;
+			return;
+		}
+	}
+
+ }
+
+ void OpenMetrics::rebuild() const {
+
+	families.resize(metric_count);
+
+	size_t length = 0;
+	for(size_t metric = 0; metric < metric_count; metric++) {
+
+		Family &family = families[metric];
+
+		family.header = "# TYPE ";
+		family.header += metrics[metric].name;
+		family.header += " gauge\n# HELP ";
+		family.header += metrics[metric].name;
+		family.header += " ";
+		family.header += metrics[metric].help;
+		family.header += "\n";
+		length += family.header.size();
+
+		family.prefixes.resize(disks.size());
+		for(size_t ix = 0; ix < disks.size(); ix++) {
+			if(metrics[metric].io && !disks[ix].io) {
+				family.prefixes[ix].clear();
+			} else {
+				family.prefixes[ix] = metrics[metric].name;
+				family.prefixes[ix] += disks[ix].labels;
+				length += family.prefixes[ix].size() + 24;
+			}
+		}
+
+	}
+
+	values.resize(disks.size() * metric_count);
+	buffer.reserve(length + 8);
+	dirty = false;
+
+ }
+
+ void OpenMetrics::render(std::string &text) const {
+	std::lock_guard<std::mutex> lock(guard);
+	format();
+	text = buffer;
+ }
+
+ void OpenMetrics::format() const {
+
+	if(dirty) {
+		rebuild();
+	}
+
+	// Collect values, reading each agent only once.
+	for(size_t ix = 0; ix < disks.size(); ix++) {
+
+		double *value = values.data() + (ix * metric_count);
+		const ::Agent &agent = *disks[ix].agent;
+		// Copied under the agent's lock, the refresh thread may be publishing a new sample.
+		const ::Agent::Snapshot snapshot = agent.getSnapshot();
+		const Udjat::FileSystem::Stats &stats = snapshot.stats;
+
+		value[0] = snapshot.used / 100;
+		value[1] = (double) agent.state()->level();
+		value[2] = (double) stats.total;
+		value[3] = (double) stats.free;
+		value[4] = (double) stats.available;
+		value[5] = (double) stats.inodes;
+		value[6] = (double) stats.ifree;
+
+		if(disks[ix].io) {
+			Udjat::DiskStats::Rates rates = disks[ix].io->rates();
+			value[7] = rates.iops;
+			value[8] = rates.read;
+			value[9] = rates.write;
+			value[10] = rates.await / 1000;
+			value[11] = rates.queue;
+			value[12] = rates.util / 100;
+		}
+
+	}
+
+	// Format values, the names and labels are already rendered.
+	buffer.clear();
+
+	char text[32];
+	for(size_t metric = 0; metric < metric_count; metric++) {
+
+		const Family &family = families[metric];
+		buffer += family.header;
+
+		for(size_t ix = 0; ix < family.prefixes.size(); ix++) {
+
+			if(family.prefixes[ix].empty()) {
+				continue;
+			}
+
+			double value = values[(ix * metric_count) + metric];
+			if(metrics[metric].integer) {
+				snprintf(text,sizeof(text),"%llu\n",(unsigned long long) value);
+			} else {
+				snprintf(text,sizeof(text),"%.6g\n",value);
+			}
+
+			buffer += family.prefixes[ix];
+			buffer += text;
+
+		}
+
+	}
+
+	buffer += "# EOF\n";
+
+ }
+
+
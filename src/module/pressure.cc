@@ -0,0 +1,270 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <pressure.h>
+ #include <udjat/tools/intl.h>
+ #include <udjat/tools/logger.h>
+ #include <udjat/tools/mainloop.h>
+ #include <system_error>
+ #include <sstream>
+ #include <iomanip>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <cstring>
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <unistd.h>
+
+ using namespace std;
+
+ PressureAgent::PressureAgent(const char *name, const pugi::xml_node &node) : super(name) {
+
+	Object::properties.icon = "drive-harddisk";
+	Object::properties.label = _( "I/O pressure" );
+
+	const char *cgroup = node.attribute("cgroup").as_string();
+	if(*cgroup) {
+		path = cgroup;
+		if(path.find('/') != 0) {
+			path.insert(0,"/sys/fs/cgroup/");
+		}
+		path += "/io.pressure";
+	} else {
+		path = "/proc/pressure/io";
+	}
+
+	full = !strcasecmp(node.attribute("stall").as_string("some"),"full");
+	threshold = node.attribute("threshold").as_uint(threshold);
+	window = node.attribute("window").as_uint(window);
+	hold = (unsigned short) node.attribute("hold").as_uint(hold);
+
+	// Event driven, no timer unless triggers are not available (see start).
+	update.timer = 0;
+
+ }
+
+ PressureAgent::~PressureAgent() {
+	// Unwatch before taking the guard, a trigger event could be waiting for it.
+	Udjat::MainLoop::getInstance().remove(this);
+	std::lock_guard<std::mutex> lock(guard);
+	if(fd >= 0) {
+		::close(fd);
+	}
+ }
+
+ void PressureAgent::start() {
+
+	if(states.empty()) {
+		texts.emplace_back(expand(_( "${name} is normal" )));
+		push_back(make_shared<Udjat::State<float>>("normal",0.0,101.0,Udjat::ready,texts.back().c_str(),""));
+	}
+
+	super::start();
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	if(fd >= 0) {
+		return;
+	}
+
+	if(!arm()) {
+		// Triggers need write access (and CAP_SYS_RESOURCE for windows under 2s on recent kernels).
+		warning() << "Can't register PSI trigger on " << path << " (" << strerror(errno) << "), polling" << endl;
+		update.timer = polling();
+	}
+
+ }
+
+ bool PressureAgent::arm() {
+
+	fd = open(path.c_str(),O_RDWR|O_NONBLOCK|O_CLOEXEC);
+
+	if(fd >= 0) {
+
+		// <some|full> <stall us> <window us>
+		char trigger[64];
+		snprintf(trigger,sizeof(trigger),"%s %u %u",(full ? "full" : "some"),threshold * 1000,window * 1000);
+
+		ssize_t rc = write(fd,trigger,strlen(trigger)+1);
+
+		if(rc < 0 && errno == EINVAL && (window % 2000)) {
+
+			// Unprivileged trigger, round the window up to 2s keeping the stall ratio.
+			unsigned int rounded = ((window / 2000) + 1) * 2000;
+			threshold = (threshold * rounded) / window;
+			window = rounded;
+
+			info() << "Using " << threshold << "ms in " << window << "ms as PSI trigger" << endl;
+			snprintf(trigger,sizeof(trigger),"%s %u %u",(full ? "full" : "some"),threshold * 1000,window * 1000);
+			rc = write(fd,trigger,strlen(trigger)+1);
+
+		}
+
+		if(rc < 0) {
+			int err = errno;
+			::close(fd);
+			fd = -1;
+			errno = err;
+		}
+
+	}
+
+	if(fd < 0) {
+		return false;
+	}
+
+	rearm = true;
+
+	Udjat::MainLoop::getInstance().insert(this,fd,(Udjat::MainLoop::Event) (POLLPRI|POLLERR),[this](const Udjat::MainLoop::Event event) {
+
+		std::lock_guard<std::mutex> lock(guard);
+
+		if(event & POLLERR) {
+			// The cgroup was removed, poll (retrying the trigger) until it's back.
+			error() << path << " is no longer available, polling" << endl;
+			Udjat::MainLoop::getInstance().remove(this);
+			::close(fd);
+			fd = -1;
+			if(!stalled) {
+				update.timer = polling();
+				requestRefresh(update.timer);
+			}
+			return false;
+		}
+
+		triggered();
+		return true;
+
+	});
+
+	return true;
+
+ }
+
+ float PressureAgent::sample() const {
+
+	char buffer[256];
+	ssize_t length;
+
+	if(fd >= 0) {
+		length = pread(fd,buffer,sizeof(buffer)-1,0);
+	} else {
+		int handle = open(path.c_str(),O_RDONLY|O_CLOEXEC);
+		if(handle < 0) {
+			throw system_error(errno,system_category(),path);
+		}
+		length = read(handle,buffer,sizeof(buffer)-1);
+		::close(handle);
+	}
+
+	if(length < 0) {
+		throw system_error(errno,system_category(),path);
+	}
+	buffer[length] = 0;
+
+	// some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+	// full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+	const char *line = strstr(buffer,(full ? "full " : "some "));
+	const char *avg10 = (line ? strstr(line,"avg10=") : nullptr);
+	if(!avg10) {
+		throw runtime_error(string{"Unexpected contents in "} + path);
+	}
+
+	return strtof(avg10+6,NULL);
+
+ }
+
+ void PressureAgent::triggered() {
+
+	try {
+		set(sample());
+	} catch(const std::exception &e) {
+		error() << e.what() << endl;
+	}
+
+	stalling();
+
+ }
+
+ void PressureAgent::stalling() {
+
+	bool changed = !stalled;
+	stalled = time(nullptr);
+
+	if(changed) {
+		if(!stall) {
+			texts.emplace_back(expand(_( "Tasks are stalled on ${name}" )));
+			stall = make_shared<Udjat::Abstract::State>("stalled",Udjat::warning,texts.back().c_str());
+		}
+		warning() << "I/O stall above " << threshold << "ms in " << window << "ms" << endl;
+		activate(stall);
+
+		// Follow the averages until the trigger is quiet.
+		update.timer = (unsigned short) (hold > 10 ? 10 : (hold ? hold : 1));
+		requestRefresh(update.timer);
+	}
+
+ }
+
+ bool PressureAgent::refresh() {
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	if(fd < 0 && rearm && arm()) {
+		info() << "PSI trigger on " << path << " registered again" << endl;
+		if(!stalled) {
+			update.timer = 0;
+		}
+	}
+
+	float value = sample();
+	set(value);
+
+	if(fd < 0 && value >= (((float) threshold) * 100 / ((float) window))) {
+		// Polling, no trigger: compare the 10s average with the threshold.
+		stalling();
+		return true;
+	}
+
+	if(stalled && (time(nullptr) - stalled) >= hold) {
+		info() << "No I/O stalls in the last " << hold << " seconds" << endl;
+		stalled = 0;
+		activate(stateFromValue());
+		update.timer = (fd >= 0 ? 0 : polling());
+	}
+
+	return true;
+
+ }
+
+ std::shared_ptr<Udjat::Abstract::State> PressureAgent::stateFromValue() const {
+	if(stalled && stall) {
+		return stall;
+	}
+	return super::stateFromValue();
+ }
+
+ std::string PressureAgent::to_string() const noexcept {
+	std::stringstream out;
+	out << std::fixed << std::setprecision(2) << super::get() << "%";
+	return out.str();
+ }
+
@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <processes.h>
+ #include <udjat/tools/intl.h>
+
+ using namespace std;
+
+ ProcessAgent::ProcessAgent(size_t limit, unsigned short interval) : Udjat::Abstract::Agent("processes"), io(limit) {
+
+	Object::properties.icon = "utilities-system-monitor";
+	Object::properties.label = _( "Processes doing I/O" );
+
+	update.timer = interval;
+
+ }
+
+ ProcessAgent::~ProcessAgent() {
+ }
+
+ bool ProcessAgent::refresh() {
+	std::lock_guard<std::mutex> lock(guard);
+	io.sample();
+	return true;
+ }
+
+ void ProcessAgent::report(Udjat::Value &value) const {
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	for(const auto &talker : io.top()) {
+		Udjat::Value &process = value.append(Udjat::Value::Object);
+		process["pid"] = (int) talker.pid;
+		process["name"] = talker.comm;
+		process["read"] = talker.read;		// bytes/second
+		process["write"] = talker.write;	// bytes/second
+	}
+
+ }
+
+ void ProcessAgent::get(const Udjat::Request &request, Udjat::Response &response) {
+	Udjat::Abstract::Agent::get(request,response);
+	report(response["processes"]);
+ }
+
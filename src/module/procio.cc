@@ -0,0 +1,219 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/procio.h>
+ #include <system_error>
+ #include <algorithm>
+ #include <cstring>
+ #include <cstdlib>
+ #include <ctime>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <dirent.h>
+ #include <sys/syscall.h>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	/// @brief Directory entry, as returned by getdents64.
+	struct proc_dirent64 {
+		ino64_t d_ino;
+		off64_t d_off;
+		unsigned short d_reclen;
+		unsigned char d_type;
+		char d_name[256];
+	};
+
+	/// @brief Get value of 'name: value' field.
+	static uint64_t field(const char *text, const char *name) noexcept {
+		const char *ptr = strstr(text,name);
+		return ptr ? strtoull(ptr + strlen(name),NULL,10) : 0;
+	}
+
+	void ProcessIO::Table::reset(size_t count) {
+
+		size_t capacity = 1024;
+		while(capacity < (count * 2)) {
+			capacity <<= 1;
+		}
+
+		if(slots.size() != capacity) {
+			slots.resize(capacity);
+		}
+
+		std::fill(slots.begin(),slots.end(),Slot{0,0,0});
+		this->count = 0;
+
+	}
+
+	void ProcessIO::Table::grow() {
+
+		std::vector<Slot> old{std::move(slots)};
+		slots.assign(old.size() * 2,Slot{0,0,0});
+
+		for(const Slot &slot : old) {
+			if(slot.pid) {
+				at(slot.pid) = slot;
+			}
+		}
+
+	}
+
+	ProcessIO::ProcessIO(size_t l, const char *p) : path(p), limit(l) {
+		tables[0].reset(0);
+		tables[1].reset(0);
+		talkers.reserve(limit);
+	}
+
+	void ProcessIO::sample() {
+
+		int dir = open(path.c_str(),O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+		if(dir < 0) {
+			throw system_error(errno,system_category(),path);
+		}
+
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		double now = ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+		double elapsed = now - timestamp;
+
+		Table &previous = tables[current];
+		Table &table = tables[current ^ 1];
+		table.reset(processes > previous.count ? processes : previous.count);
+
+		candidates.clear();
+
+		char buffer[16384];
+		char text[1024];
+		long length;
+
+		while((length = syscall(SYS_getdents64,dir,buffer,sizeof(buffer))) > 0) {
+
+			for(long offset = 0; offset < length;) {
+
+				const proc_dirent64 *entry = (const proc_dirent64 *) (buffer + offset);
+				offset += entry->d_reclen;
+
+				if(entry->d_name[0] < '1' || entry->d_name[0] > '9') {
+					continue;
+				}
+
+				pid_t pid = (pid_t) atoi(entry->d_name);
+
+				char filename[300];
+				snprintf(filename,sizeof(filename),"%s/io",entry->d_name);
+
+				int fd = openat(dir,filename,O_RDONLY|O_CLOEXEC);
+				if(fd < 0) {
+					// Process is gone or not accessible.
+					continue;
+				}
+
+				ssize_t bytes = read(fd,text,sizeof(text)-1);
+				::close(fd);
+
+				if(bytes <= 0) {
+					continue;
+				}
+				text[bytes] = 0;
+
+				// More processes than in the last sample.
+				if((table.count + 1) * 2 > table.slots.size()) {
+					table.grow();
+				}
+
+				Slot &slot = table.at(pid);
+				slot.pid = pid;
+				slot.read = field(text,"\nread_bytes: ");
+				slot.write = field(text,"\nwrite_bytes: ");
+				table.count++;
+
+				if(!timestamp) {
+					continue;
+				}
+
+				// Delta from the previous sample; processes started since then (or a
+				// reused pid, with counters going back) count everything.
+				uint64_t read = slot.read;
+				uint64_t write = slot.write;
+
+				const Slot &last = previous.at(pid);
+				if(last.pid && slot.read >= last.read && slot.write >= last.write) {
+					read -= last.read;
+					write -= last.write;
+				}
+
+				if(read || write) {
+					Talker talker;
+					talker.pid = pid;
+					talker.comm[0] = 0;
+					talker.read = ((double) read) / elapsed;
+					talker.write = ((double) write) / elapsed;
+					candidates.push_back(talker);
+				}
+
+			}
+
+		}
+
+		::close(dir);
+
+		processes = table.count;
+		current ^= 1;
+		timestamp = now;
+
+		// Partial sort, only the top-K is ordered.
+		size_t count = std::min(limit,candidates.size());
+		std::partial_sort(candidates.begin(),candidates.begin()+count,candidates.end(),[](const Talker &a, const Talker &b){
+			return (a.read + a.write) > (b.read + b.write);
+		});
+
+		talkers.assign(candidates.begin(),candidates.begin()+count);
+
+		// Command names only for the talkers.
+		for(auto &talker : talkers) {
+
+			snprintf(text,sizeof(text),"%s/%d/comm",path.c_str(),(int) talker.pid);
+			int fd = open(text,O_RDONLY|O_CLOEXEC);
+			if(fd < 0) {
+				strcpy(talker.comm,"?");
+				continue;
+			}
+
+			ssize_t bytes = read(fd,talker.comm,sizeof(talker.comm)-1);
+			::close(fd);
+
+			if(bytes < 0) {
+				bytes = 0;
+			}
+			talker.comm[bytes] = 0;
+
+			char *eol = strchr(talker.comm,'\n');
+			if(eol) {
+				*eol = 0;
+			}
+
+		}
+
+	}
+
+ }
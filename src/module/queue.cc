@@ -0,0 +1,272 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/queue.h>
+ #include <algorithm>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <cstring>
+ #include <dirent.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/sysmacros.h>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	/// @brief Read a sysfs attribute, without the trailing newline.
+	/// @return false if the file can't be read.
+	static bool load(const std::string &filename, std::string &value) {
+
+		int fd = open(filename.c_str(),O_RDONLY|O_CLOEXEC);
+		if(fd < 0) {
+			return false;
+		}
+
+		char text[512];
+		ssize_t length = read(fd,text,sizeof(text)-1);
+		::close(fd);
+
+		if(length < 0) {
+			return false;
+		}
+
+		while(length > 0 && (text[length-1] == '\n' || text[length-1] == ' ')) {
+			length--;
+		}
+		text[length] = 0;
+
+		value = text;
+		return true;
+
+	}
+
+	/// @brief Get DEVNAME from an uevent file.
+	static std::string devname(const std::string &filename) {
+
+		std::string text;
+		if(!load(filename,text)) {
+			return std::string{};
+		}
+
+		size_t pos = text.find("DEVNAME=");
+		if(pos == std::string::npos) {
+			return std::string{};
+		}
+
+		pos += 8;
+		return text.substr(pos,text.find('\n',pos) - pos);
+
+	}
+
+	Queue::Queue(const char *d, const char *sysfs) : path(std::string{sysfs} + "/block/" + d + "/queue"), disk(d) {
+
+		if(!strncmp(d,"nvme",4)) {
+			type = "nvme";
+		} else if(!strncmp(d,"loop",4) || !strncmp(d,"zram",4) || !strncmp(d,"dm-",3) || !strncmp(d,"md",2)) {
+			type = "virtual";
+		} else if(get("rotational") == "1") {
+			type = "hdd";
+		} else {
+			type = "ssd";
+		}
+
+	}
+
+	std::string Queue::name(dev_t dev, const char *sysfs) {
+
+		char path[128];
+		snprintf(path,sizeof(path),"%s/dev/block/%u:%u",sysfs,major(dev),minor(dev));
+
+		std::string filename{path};
+
+		// Partitions have a 'partition' attribute, the disk is the parent directory.
+		if(access((filename + "/partition").c_str(),F_OK) == 0) {
+			return devname(filename + "/../uevent");
+		}
+
+		return devname(filename + "/uevent");
+
+	}
+
+	std::vector<std::string> Queue::members(const char *disk, const char *sysfs) {
+
+		std::vector<std::string> disks;
+
+		std::string path{sysfs};
+		path += "/block/";
+		path += disk;
+		path += "/slaves";
+
+		DIR *dir = opendir(path.c_str());
+		if(!dir) {
+			return disks;
+		}
+
+		struct dirent *entry;
+		while((entry = readdir(dir)) != NULL) {
+
+			if(entry->d_name[0] == '.') {
+				continue;
+			}
+
+			// Members can be partitions, the queue is on their disk.
+			std::string slave{path + "/" + entry->d_name};
+			std::string name = (access((slave + "/partition").c_str(),F_OK) == 0 ? devname(slave + "/../uevent") : std::string{entry->d_name});
+			if(name.empty()) {
+				continue;
+			}
+
+			// Stacked devices (LVM on md, ...).
+			std::vector<std::string> nested = members(name.c_str(),sysfs);
+			if(nested.empty()) {
+				nested.push_back(name);
+			}
+
+			for(auto &member : nested) {
+				if(std::find(disks.begin(),disks.end(),member) == disks.end()) {
+					disks.push_back(std::move(member));
+				}
+			}
+
+		}
+
+		closedir(dir);
+		return disks;
+
+	}
+
+	const std::vector<Queue::Rule> & Queue::defaults() {
+
+		static const std::vector<Rule> rules = {
+
+			// NVMe queues are deep enough to not need a scheduler; rotational disks need one to merge and sort.
+			{ "nvme", "scheduler", "none", 0, 0 },
+			{ "ssd", "scheduler", "none|mq-deadline|kyber", 0, 0 },
+			{ "hdd", "scheduler", "mq-deadline|bfq", 0, 0 },
+
+			// The 128KB default read-ahead starves sequential reads on rotational disks.
+			{ "hdd", "read_ahead_kb", "", 1024, 0 },
+
+			// A shallow queue leaves nothing for the scheduler to merge, or the flash to run in parallel.
+			{ "hdd", "nr_requests", "", 64, 0 },
+			{ "ssd", "nr_requests", "", 64, 0 },
+
+			// Small request limits split large I/O into many commands.
+			{ "nvme", "max_sectors_kb", "", 512, 0 },
+			{ "ssd", "max_sectors_kb", "", 512, 0 },
+			{ "hdd", "max_sectors_kb", "", 512, 0 },
+
+			// 'write through' on a disk with a volatile cache disables the flushes (or the cache itself);
+			// disks behind battery backed controllers report it too, override with a rule for them.
+			{ "nvme", "write_cache", "write back", 0, 0 },
+			{ "ssd", "write_cache", "write back", 0, 0 },
+			{ "hdd", "write_cache", "write back", 0, 0 },
+
+		};
+
+		return rules;
+
+	}
+
+	std::string Queue::get(const char *attribute) const {
+
+		std::string value;
+		if(!load(path + "/" + attribute,value)) {
+			return std::string{};
+		}
+
+		if(!strcmp(attribute,"scheduler")) {
+			// Available schedulers with the active one in brackets: 'none [mq-deadline] kyber'.
+			size_t from = value.find('[');
+			size_t to = value.find(']');
+			if(from != std::string::npos && to != std::string::npos && to > from) {
+				return value.substr(from+1,to-from-1);
+			}
+		}
+
+		return value;
+
+	}
+
+	std::string Queue::Rule::check(const std::string &current) const {
+
+		if(!value.empty()) {
+
+			size_t from = 0;
+			while(from <= value.size()) {
+				size_t to = value.find('|',from);
+				if(to == std::string::npos) {
+					to = value.size();
+				}
+				if(!value.compare(from,to-from,current)) {
+					return std::string{};
+				}
+				from = to + 1;
+			}
+
+			return value.substr(0,value.find('|'));
+
+		}
+
+		uint64_t number = strtoull(current.c_str(),nullptr,10);
+
+		if(min && number < min) {
+			return std::to_string(min);
+		}
+
+		if(max && number > max) {
+			return std::to_string(max);
+		}
+
+		return std::string{};
+
+	}
+
+	std::vector<Queue::Mismatch> Queue::check(const std::vector<Rule> &rules) const {
+
+		std::vector<Mismatch> mismatches;
+
+		for(const Rule &rule : rules) {
+
+			if(rule.device != "*" && rule.device != type && rule.device != disk) {
+				continue;
+			}
+
+			std::string current = get(rule.attribute.c_str());
+			if(current.empty()) {
+				// Not available on this disk (or kernel).
+				continue;
+			}
+
+			std::string recommended = rule.check(current);
+			if(!recommended.empty()) {
+				mismatches.push_back(Mismatch{rule.attribute,current,recommended});
+			}
+
+		}
+
+		return mismatches;
+
+	}
+
+ }
@@ -0,0 +1,240 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <queues.h>
+ #include <udjat/atom.h>
+ #include <udjat/tools/intl.h>
+ #include <udjat/tools/logger.h>
+ #include <set>
+
+ using namespace std;
+
+ class QueueAgent::Disk : public Udjat::Agent<unsigned int> {
+ private:
+
+	const QueueAgent &owner;
+
+	Udjat::Atom id;
+
+	Udjat::Queue queue;
+
+	/// @brief Settings not matching the rules (from the last check).
+	std::vector<Udjat::Queue::Mismatch> mismatches;
+
+	/// @brief Warning state, rebuilt when the mismatches change.
+	std::shared_ptr<Udjat::Abstract::State> misconfigured;
+	Udjat::Atom summary;
+
+ protected:
+
+	std::shared_ptr<Udjat::Abstract::State> stateFromValue() const override {
+		if(misconfigured) {
+			return misconfigured;
+		}
+		return Udjat::Agent<unsigned int>::stateFromValue();
+	}
+
+ public:
+	Disk(const QueueAgent &o, const Udjat::Atom &name)
+		: Udjat::Agent<unsigned int>(name.c_str()), owner(o), id(name), queue(name.c_str(),o.sysfs.c_str()) {
+		Object::properties.icon = "drive-harddisk";
+		Object::properties.label = id.c_str();
+		update.timer = owner.interval;
+	}
+
+	void start() override {
+		if(states.empty()) {
+			push_back(make_shared<Udjat::State<unsigned int>>("ok",0,0,Udjat::ready,_( "Block queue settings match the rules" ),""));
+		}
+		Udjat::Abstract::Agent::start();
+	}
+
+	bool refresh() override {
+
+		std::vector<Udjat::Queue::Mismatch> current = queue.check(owner.rules);
+
+		// Summary like "scheduler is 'mq-deadline', recommended 'none'"
+		std::string text;
+		for(const auto &mismatch : current) {
+			if(!text.empty()) {
+				text += "; ";
+			}
+			text += mismatch.attribute;
+			text += _( " is '" );
+			text += mismatch.current;
+			text += _( "', recommended '" );
+			text += mismatch.recommended;
+			text += "'";
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(owner.guard);
+			mismatches = std::move(current);
+		}
+
+		if(text.empty()) {
+			misconfigured.reset();
+			summary = Udjat::Atom{};
+		} else if(text != summary.c_str()) {
+			warning() << text << endl;
+			summary = text;
+			misconfigured = make_shared<Udjat::Abstract::State>("misconfigured",Udjat::warning,summary.c_str());
+		}
+
+		set((unsigned int) mismatches.size());
+
+		auto state = stateFromValue();
+		if(state != this->state()) {
+			activate(state);
+		}
+
+		return true;
+
+	}
+
+	/// @brief Export mismatches (with the owner's guard locked).
+	void report(Udjat::Value &value) const {
+		for(const auto &mismatch : mismatches) {
+			Udjat::Value &item = value.append(Udjat::Value::Object);
+			item["disk"] = queue.name();
+			item["type"] = queue.getType();
+			item["attribute"] = mismatch.attribute;
+			item["current"] = mismatch.current;
+			item["recommended"] = mismatch.recommended;
+		}
+	}
+
+	void get(const Udjat::Request &request, Udjat::Response &response) override {
+		Udjat::Agent<unsigned int>::get(request,response);
+		response["type"] = queue.getType();
+		std::lock_guard<std::mutex> lock(owner.guard);
+		report(response["mismatches"]);
+	}
+
+ };
+
+ QueueAgent::QueueAgent(const char *name, const pugi::xml_node &node) : Udjat::Abstract::Agent(name), sysfs(node.attribute("sysfs").as_string("/sys")) {
+
+	Object::properties.icon = "drive-multidisk";
+	Object::properties.label = _( "Block queue settings" );
+
+	interval = (unsigned short) node.attribute("queues-timer").as_uint(interval);
+
+	// <rule device='nvme|ssd|hdd|virtual|[disk]|*' attribute='scheduler' value='none|mq-deadline' />
+	// <rule device='sdb' attribute='read_ahead_kb' min='4096' />
+	for(auto child : node.children("rule")) {
+
+		Udjat::Queue::Rule rule;
+		rule.device = child.attribute("device").as_string("*");
+		rule.attribute = child.attribute("attribute").as_string();
+		rule.value = child.attribute("value").as_string();
+		rule.min = child.attribute("min").as_uint(0);
+		rule.max = child.attribute("max").as_uint(0);
+
+		if(rule.attribute.empty() || (rule.value.empty() && !rule.min && !rule.max)) {
+			warning() << "Ignoring incomplete queue rule" << endl;
+			continue;
+		}
+
+		rules.push_back(rule);
+
+	}
+
+	if(rules.empty()) {
+		rules = Udjat::Queue::defaults();
+	}
+
+ }
+
+ QueueAgent::~QueueAgent() {
+ }
+
+ void QueueAgent::start() {
+	Udjat::Abstract::Agent::start();
+	started = true;
+ }
+
+ void QueueAgent::set(const Udjat::MountInfo &mounts) {
+
+	// Disks behind a mount point.
+	std::set<std::string> disks;
+	for(const auto &entry : mounts) {
+		if(entry.device) {
+			std::string disk = Udjat::Queue::name(entry.device,sysfs.c_str());
+			if(!disk.empty()) {
+				disks.insert(disk);
+				// The physical disks under LVM or md, their queues are the ones to tune.
+				for(auto &member : Udjat::Queue::members(disk.c_str(),sysfs.c_str())) {
+					disks.insert(member);
+				}
+			}
+		}
+	}
+
+	std::vector<std::shared_ptr<Udjat::Abstract::Agent>> retired;
+	std::vector<std::shared_ptr<Disk>> added;
+
+	{
+		// report() walks the children from the HTTP thread.
+		std::lock_guard<std::mutex> lock(guard);
+
+		// Remove the agents of unmounted disks, keep the others.
+		for(auto child : *this) {
+			auto disk = dynamic_pointer_cast<Disk>(child);
+			if(disk && !disks.erase(disk->name())) {
+				retired.push_back(child);
+			}
+		}
+
+		for(auto &child : retired) {
+			Udjat::Abstract::Agent::remove(child);
+		}
+
+		for(const auto &name : disks) {
+			auto disk = make_shared<Disk>(*this,Udjat::Atom{name});
+			Udjat::Abstract::Agent::push_back(disk);
+			added.push_back(disk);
+		}
+	}
+
+	// Started without the guard, a refresh takes it to store the mismatches.
+	if(started) {
+		for(auto &disk : added) {
+			disk->start();
+		}
+	}
+
+ }
+
+ void QueueAgent::report(Udjat::Value &value) {
+	std::lock_guard<std::mutex> lock(guard);
+	for(auto child : *this) {
+		auto disk = dynamic_cast<const Disk *>(child.get());
+		if(disk) {
+			disk->report(value);
+		}
+	}
+ }
+
+ void QueueAgent::get(const Udjat::Request &request, Udjat::Response &response) {
+	Udjat::Abstract::Agent::get(request,response);
+	report(response["mismatches"]);
+ }
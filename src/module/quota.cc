@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/quota.h>
+ #include <system_error>
+ #include <cerrno>
+ #include <cstring>
+ #include <sys/quota.h>
+ #include <linux/dqblk_xfs.h>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	static inline float ratio(uint64_t value, uint64_t soft, uint64_t hard) noexcept {
+		uint64_t limit = (soft ? soft : hard);
+		return limit ? (((float) value) / ((float) limit)) : 0;
+	}
+
+	float Quota::Entry::percent() const noexcept {
+		float space = ratio(this->space,space_soft,space_hard);
+		float inodes = ratio(this->inodes,inodes_soft,inodes_hard);
+		return (space > inodes ? space : inodes) * 100;
+	}
+
+	const char * Quota::name(Type type) noexcept {
+		static const char *names[] = { "user", "group", "project" };
+		return type < (sizeof(names)/sizeof(names[0])) ? names[type] : "unknown";
+	}
+
+	/// @brief Generic quota format (ext4, btrfs, tmpfs, XFS on recent kernels).
+	static bool generic(const char *device, Quota::Type type, uint32_t &id, Quota::Entry &entry) {
+
+		struct if_nextdqblk dq;
+		memset(&dq,0,sizeof(dq));
+
+		if(quotactl(QCMD(Q_GETNEXTQUOTA,type),device,id,(caddr_t) &dq)) {
+			return false;
+		}
+
+		entry.id = id = dq.dqb_id;
+		entry.space = dq.dqb_curspace;
+		entry.space_soft = dq.dqb_bsoftlimit * QIF_DQBLKSIZE;
+		entry.space_hard = dq.dqb_bhardlimit * QIF_DQBLKSIZE;
+		entry.inodes = dq.dqb_curinodes;
+		entry.inodes_soft = dq.dqb_isoftlimit;
+		entry.inodes_hard = dq.dqb_ihardlimit;
+
+		return true;
+
+	}
+
+	/// @brief XFS quota format (limits and usage in 512 bytes basic blocks).
+	static bool xfs(const char *device, Quota::Type type, uint32_t &id, Quota::Entry &entry) {
+
+		fs_disk_quota_t dq;
+		memset(&dq,0,sizeof(dq));
+
+		if(quotactl(QCMD(Q_XGETNEXTQUOTA,type),device,id,(caddr_t) &dq)) {
+			return false;
+		}
+
+		entry.id = id = dq.d_id;
+		entry.space = dq.d_bcount * 512;
+		entry.space_soft = dq.d_blk_softlimit * 512;
+		entry.space_hard = dq.d_blk_hardlimit * 512;
+		entry.inodes = dq.d_icount;
+		entry.inodes_soft = dq.d_ino_softlimit;
+		entry.inodes_hard = dq.d_ino_hardlimit;
+
+		return true;
+
+	}
+
+	bool Quota::get(const char *device, Type type, const std::function<void(const Entry &entry)> &call) {
+
+		auto next = generic;
+		Entry entry;
+		entry.type = type;
+
+		for(uint32_t id = 0;;) {
+
+			if(!next(device,type,id,entry)) {
+
+				if(errno == ENOENT) {
+					// No more ids.
+					break;
+				}
+
+				if(errno == ESRCH) {
+					// Quotas of this type are not enabled.
+					return false;
+				}
+
+				if(next == generic && (errno == EINVAL || errno == ENOSYS)) {
+					// Kernel without Q_GETNEXTQUOTA for this filesystem, try the XFS interface.
+					next = xfs;
+					continue;
+				}
+
+				throw system_error(errno,system_category(),device);
+
+			}
+
+			call(entry);
+
+			if(id == UINT32_MAX) {
+				break;
+			}
+			id++;
+
+		}
+
+		return true;
+
+	}
+
+ }
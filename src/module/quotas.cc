@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <quotas.h>
+ #include <udjat/tools/quark.h>
+ #include <udjat/tools/intl.h>
+ #include <udjat/tools/logger.h>
+ #include <sstream>
+ #include <iomanip>
+ #include <cstring>
+ #include <pwd.h>
+ #include <grp.h>
+
+ using namespace std;
+
+ static const struct {
+	float from;
+	float to;
+	const char 						* name;			///< @brief State name.
+	Udjat::Level					  level;		///< @brief State level.
+	const char						* summary;		///< @brief State summary.
+ } quotastates[] = {
+	{  0.0,		80.0,	"good",		Udjat::ready,	N_( "All quotas on ${name} are below 80%" )		},
+	{ 80.0,		95.0,	"near",		Udjat::warning,	N_( "A quota on ${name} is above 80%" )			},
+	{ 95.0,		1e9,	"full",		Udjat::error,	N_( "A quota on ${name} is above 95%" )			},
+ };
+
+ QuotaAgent::QuotaAgent(const char *mp, const char *dev, const char *name, const pugi::xml_node &node)
+	: super(name), mount_point(mp), device(dev), limit(node.attribute("top").as_uint(10)), top(limit) {
+
+	Object::properties.icon = "drive-harddisk";
+	Object::properties.label = _( "Disk quotas" );
+
+	update.timer = (unsigned short) node.attribute("update-timer").as_uint(300);
+
+	// Quota types from the 'quotas' attribute (user,group,project).
+	std::string list{node.attribute("quotas").as_string("user,group,project")};
+	for(Udjat::Quota::Type type : { Udjat::Quota::User, Udjat::Quota::Group, Udjat::Quota::Project }) {
+		if(list.find(Udjat::Quota::name(type)) != std::string::npos) {
+			types.push_back(type);
+		}
+	}
+
+ }
+
+ QuotaAgent::~QuotaAgent() {
+ }
+
+ void QuotaAgent::start() {
+
+	if(super::states.empty()) {
+
+		for(size_t ix = 0; ix < (sizeof(quotastates)/sizeof(quotastates[0])); ix++) {
+			push_back(
+				make_shared<Udjat::State<float>>(
+					quotastates[ix].name,
+					quotastates[ix].from,
+					quotastates[ix].to,
+					quotastates[ix].level,
+#ifdef GETTEXT_PACKAGE
+					Udjat::Quark(expand(dgettext(GETTEXT_PACKAGE,quotastates[ix].summary))).c_str(),
+#else
+					Udjat::Quark(expand(quotastates[ix].summary)).c_str(),
+#endif
+					""
+				)
+			);
+		}
+
+	}
+
+	super::start();
+
+ }
+
+ bool QuotaAgent::refresh() {
+
+	// Walk without the lock, the exported top-K is replaced at the end.
+	Udjat::Ranking<uint64_t,Udjat::Quota::Entry> current{limit};
+	size_t count = 0;
+
+	for(auto type : types) {
+
+		bool enabled = Udjat::Quota::get(device.c_str(),type,[&current,&count](const Udjat::Quota::Entry &entry){
+			count++;
+			float percent = entry.percent();
+			if(percent > 0 && current.accepts(percent)) {
+				current.set((((uint64_t) entry.type) << 32) | entry.id,percent,entry);
+			}
+		});
+
+		if(!enabled) {
+			info() << Udjat::Quota::name(type) << " quotas are not enabled on " << mount_point << endl;
+		}
+
+	}
+
+	float highest = 0;
+	for(const auto &item : current.sorted()) {
+		highest = item.score;
+		break;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(guard);
+		top = std::move(current);
+		ids = count;
+	}
+
+	set(highest);
+	return true;
+
+ }
+
+ /// @brief Get user or group name for the quota id.
+ static std::string owner(const Udjat::Quota::Entry &entry) {
+
+	char buffer[4096];
+
+	if(entry.type == Udjat::Quota::User) {
+		struct passwd pw, *result = nullptr;
+		if(!getpwuid_r((uid_t) entry.id,&pw,buffer,sizeof(buffer),&result) && result) {
+			return result->pw_name;
+		}
+	} else if(entry.type == Udjat::Quota::Group) {
+		struct group gr, *result = nullptr;
+		if(!getgrgid_r((gid_t) entry.id,&gr,buffer,sizeof(buffer),&result) && result) {
+			return result->gr_name;
+		}
+	}
+
+	return std::to_string(entry.id);
+
+ }
+
+ void QuotaAgent::get(const Udjat::Request &request, Udjat::Response &response) {
+
+	super::get(request,response);
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	response["ids"] = (unsigned long long) ids;
+
+	Udjat::Value &quotas = response["quotas"];
+	for(const auto &item : top.sorted()) {
+		Udjat::Value &quota = quotas.append(Udjat::Value::Object);
+		quota["type"] = Udjat::Quota::name(item.data.type);
+		quota["id"] = (unsigned int) item.data.id;
+		quota["name"] = owner(item.data);
+		quota["percent"] = (float) item.score;
+		quota["space"] = (unsigned long long) item.data.space;
+		quota["space-limit"] = (unsigned long long) (item.data.space_soft ? item.data.space_soft : item.data.space_hard);
+		quota["inodes"] = (unsigned long long) item.data.inodes;
+		quota["inodes-limit"] = (unsigned long long) (item.data.inodes_soft ? item.data.inodes_soft : item.data.inodes_hard);
+	}
+
+ }
+
+ std::string QuotaAgent::to_string() const noexcept {
+	std::stringstream out;
+	out << std::fixed << std::setprecision(2) << super::get() << "%";
+	return out.str();
+ }
+
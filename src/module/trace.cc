@@ -0,0 +1,416 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <udjat/backend.h>
+ #include <system_error>
+ #include <stdexcept>
+ #include <unordered_map>
+ #include <algorithm>
+ #include <mutex>
+ #include <thread>
+ #include <chrono>
+ #include <cstdio>
+ #include <cstring>
+ #include <cstdlib>
+ #include <ctime>
+ #include <unistd.h>
+ #include <fcntl.h>
+
+ using namespace std;
+
+ //
+ // Trace format, one record per line, tab separated:
+ //
+ // <seconds> device <devname> <label> <type> <dev>
+ // <seconds> mountinfo <text>
+ // <seconds> diskstats <text>
+ // <seconds> stats <mount point> <errno> <total> <free> <available> <inodes> <ifree> <latency us>
+ //
+ // Tabs, newlines and backslashes in fields are escaped as \t, \n and \\.
+ //
+
+ namespace Udjat {
+
+	static double monotonic() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+	}
+
+	static void escape(FILE *out, const char *str) {
+		for(;*str;str++) {
+			switch(*str) {
+			case '\\':
+				fputs("\\\\",out);
+				break;
+			case '\n':
+				fputs("\\n",out);
+				break;
+			case '\t':
+				fputs("\\t",out);
+				break;
+			default:
+				fputc(*str,out);
+			}
+		}
+	}
+
+	/// @brief Split trace line in unescaped fields.
+	static void split(const char *line, std::vector<string> &fields) {
+
+		fields.clear();
+		fields.emplace_back();
+
+		for(;*line && *line != '\n';line++) {
+
+			if(*line == '\t') {
+				fields.emplace_back();
+			} else if(*line == '\\' && line[1]) {
+				line++;
+				switch(*line) {
+				case 'n':
+					fields.back() += '\n';
+					break;
+				case 't':
+					fields.back() += '\t';
+					break;
+				default:
+					fields.back() += *line;
+				}
+			} else {
+				fields.back() += *line;
+			}
+
+		}
+
+	}
+
+	//
+	// Recorder
+	//
+
+	struct Backend::Recorder::Trace {
+		std::mutex guard;
+		FILE *out;
+		double start;
+
+		Trace(const char *filename) : out(fopen(filename,"we")), start(monotonic()) {
+			if(!out) {
+				throw system_error(errno,system_category(),filename);
+			}
+		}
+
+		~Trace() {
+			fclose(out);
+		}
+
+		/// @brief Start record (must hold guard).
+		void begin(const char *type) {
+			fprintf(out,"%.6f\t%s",monotonic()-start,type);
+		}
+
+		void end() {
+			fputc('\n',out);
+			fflush(out);
+		}
+
+	};
+
+	Backend::Recorder::Recorder(const char *filename) : trace(new Trace(filename)) {
+	}
+
+	Backend::Recorder::~Recorder() {
+	}
+
+	void Backend::Recorder::discover(std::vector<BlockDevice> &devices, bool probe) {
+
+		size_t first = devices.size();
+		Backend::discover(devices,probe);
+
+		std::lock_guard<std::mutex> lock(trace->guard);
+		for(size_t ix = first; ix < devices.size(); ix++) {
+			trace->begin("device");
+			for(const string *field : { &devices[ix].devname, &devices[ix].label, &devices[ix].type }) {
+				fputc('\t',trace->out);
+				escape(trace->out,field->c_str());
+			}
+			fprintf(trace->out,"\t%llu",(unsigned long long) devices[ix].dev);
+			trace->end();
+		}
+
+	}
+
+	void Backend::Recorder::mountinfo(MountInfo &mounts, int fd) {
+
+		string text;
+
+		{
+			char buffer[4096];
+			ssize_t bytes;
+
+			if(fd < 0) {
+				fd = open("/proc/self/mountinfo",O_RDONLY|O_CLOEXEC);
+				if(fd < 0) {
+					throw system_error(errno,system_category(),"/proc/self/mountinfo");
+				}
+				while((bytes = read(fd,buffer,sizeof(buffer))) > 0) {
+					text.append(buffer,bytes);
+				}
+				::close(fd);
+			} else {
+				lseek(fd,0,SEEK_SET);
+				while((bytes = read(fd,buffer,sizeof(buffer))) > 0) {
+					text.append(buffer,bytes);
+				}
+			}
+		}
+
+		mounts.parse(text.c_str());
+
+		std::lock_guard<std::mutex> lock(trace->guard);
+		trace->begin("mountinfo");
+		fputc('\t',trace->out);
+		escape(trace->out,text.c_str());
+		trace->end();
+
+	}
+
+	void Backend::Recorder::diskstats(std::string &text) {
+
+		Backend::diskstats(text);
+
+		std::lock_guard<std::mutex> lock(trace->guard);
+		trace->begin("diskstats");
+		fputc('\t',trace->out);
+		escape(trace->out,text.c_str());
+		trace->end();
+
+	}
+
+	int Backend::Recorder::stats(const char *mount_point, FileSystem::Stats &stats, const std::function<int(FileSystem::Stats &stats)> &sample) {
+
+		double started = monotonic();
+		int rc = Backend::stats(mount_point,stats,sample);
+		double latency = monotonic() - started;
+
+		std::lock_guard<std::mutex> lock(trace->guard);
+		trace->begin("stats");
+		fputc('\t',trace->out);
+		escape(trace->out,mount_point);
+		fprintf(
+			trace->out,
+			"\t%d\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu",
+			rc,
+			(unsigned long long) stats.total,
+			(unsigned long long) stats.free,
+			(unsigned long long) stats.available,
+			(unsigned long long) stats.inodes,
+			(unsigned long long) stats.ifree,
+			(unsigned long long) (latency * 1000000)
+		);
+		trace->end();
+
+		return rc;
+
+	}
+
+	//
+	// Replay
+	//
+
+	struct Backend::Replay::Trace {
+
+		std::mutex guard;
+
+		/// @brief Replay speed (0 = step).
+		float speed;
+
+		/// @brief Replay start time.
+		double start;
+
+		std::vector<BlockDevice> devices;
+
+		struct Text {
+			double time;
+			string text;
+		};
+
+		struct Texts {
+			std::vector<Text> records;
+			size_t cursor = 0;
+		} mountinfo, diskstats;
+
+		struct Sample {
+			double time;
+			int rc;
+			FileSystem::Stats stats;
+			double latency;
+		};
+
+		struct Samples {
+			std::vector<Sample> records;
+			size_t cursor = 0;
+		};
+
+		std::unordered_map<string,Samples> samples;
+
+		Trace(float s) : speed(s), start(monotonic()) {
+		}
+
+		/// @brief Get the record index for the current (virtual) time.
+		template <typename T>
+		size_t next(std::vector<T> &records, size_t &cursor) {
+
+			if(speed <= 0) {
+				// Deterministic stepping, stay on the last record.
+				size_t ix = cursor;
+				if(cursor + 1 < records.size()) {
+					cursor++;
+				}
+				return ix;
+			}
+
+			double now = (monotonic() - start) * speed;
+			auto it = std::upper_bound(records.begin(),records.end(),now,[](double time, const T &record){
+				return time < record.time;
+			});
+
+			return (it == records.begin() ? 0 : (it - records.begin()) - 1);
+
+		}
+
+	};
+
+	Backend::Replay::Replay(const char *filename, float speed) : trace(new Trace(speed)) {
+
+		FILE *in = fopen(filename,"re");
+		if(!in) {
+			throw system_error(errno,system_category(),filename);
+		}
+
+		std::vector<string> fields;
+		char *line = NULL;
+		size_t szline = 0;
+
+		while(getline(&line,&szline,in) > 0) {
+
+			split(line,fields);
+			if(fields.size() < 3) {
+				continue;
+			}
+
+			double time = strtod(fields[0].c_str(),NULL);
+			const string &type = fields[1];
+
+			if(type == "device" && fields.size() >= 6) {
+
+				trace->devices.emplace_back(fields[2].c_str(),fields[3],fields[4],(dev_t) strtoull(fields[5].c_str(),NULL,10));
+
+			} else if(type == "mountinfo") {
+
+				trace->mountinfo.records.push_back({time,fields[2]});
+
+			} else if(type == "diskstats") {
+
+				trace->diskstats.records.push_back({time,fields[2]});
+
+			} else if(type == "stats" && fields.size() >= 10) {
+
+				Trace::Sample sample;
+				sample.time = time;
+				sample.rc = atoi(fields[3].c_str());
+				sample.stats.total = strtoull(fields[4].c_str(),NULL,10);
+				sample.stats.free = strtoull(fields[5].c_str(),NULL,10);
+				sample.stats.available = strtoull(fields[6].c_str(),NULL,10);
+				sample.stats.inodes = strtoull(fields[7].c_str(),NULL,10);
+				sample.stats.ifree = strtoull(fields[8].c_str(),NULL,10);
+				sample.latency = ((double) strtoull(fields[9].c_str(),NULL,10)) / 1000000.0;
+				trace->samples[fields[2]].records.push_back(sample);
+
+			}
+
+		}
+
+		free(line);
+		fclose(in);
+
+	}
+
+	Backend::Replay::~Replay() {
+	}
+
+	void Backend::Replay::discover(std::vector<BlockDevice> &devices, bool UDJAT_UNUSED(probe)) {
+		std::lock_guard<std::mutex> lock(trace->guard);
+		devices.insert(devices.end(),trace->devices.begin(),trace->devices.end());
+	}
+
+	void Backend::Replay::mountinfo(MountInfo &mounts, int UDJAT_UNUSED(fd)) {
+
+		std::lock_guard<std::mutex> lock(trace->guard);
+
+		if(trace->mountinfo.records.empty()) {
+			throw runtime_error("No mount table in trace");
+		}
+
+		mounts.parse(trace->mountinfo.records[trace->next(trace->mountinfo.records,trace->mountinfo.cursor)].text.c_str());
+
+	}
+
+	void Backend::Replay::diskstats(std::string &text) {
+
+		std::lock_guard<std::mutex> lock(trace->guard);
+
+		if(trace->diskstats.records.empty()) {
+			throw runtime_error("No diskstats in trace");
+		}
+
+		text = trace->diskstats.records[trace->next(trace->diskstats.records,trace->diskstats.cursor)].text;
+
+	}
+
+	int Backend::Replay::stats(const char *mount_point, FileSystem::Stats &stats, const std::function<int(FileSystem::Stats &stats)> UDJAT_UNUSED(&sample)) {
+
+		Trace::Sample record;
+		float speed;
+
+		{
+			std::lock_guard<std::mutex> lock(trace->guard);
+
+			auto it = trace->samples.find(mount_point);
+			if(it == trace->samples.end() || it->second.records.empty()) {
+				return ENOENT;
+			}
+
+			record = it->second.records[trace->next(it->second.records,it->second.cursor)];
+			speed = trace->speed;
+		}
+
+		if(speed > 0 && record.latency > 0) {
+			// Reproduce the recorded latency (scaled), slow mounts will hit the sample timeout.
+			std::this_thread::sleep_for(std::chrono::microseconds((long long) (record.latency * 1000000 / speed)));
+		}
+
+		stats = record.stats;
+		return record.rc;
+
+	}
+
+ }
@@ -0,0 +1,219 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <usage.h>
+ #include <udjat/atom.h>
+ #include <udjat/tools/intl.h>
+ #include <udjat/tools/logger.h>
+ #include <sstream>
+ #include <iomanip>
+ #include <thread>
+
+ using namespace std;
+
+ static std::string format(uint64_t bytes) {
+
+	static const char *units[] = { "B", "KB", "MB", "GB", "TB", "PB" };
+
+	double value = (double) bytes;
+	size_t ix = 0;
+	while(value >= 1024.0 && ix < ((sizeof(units)/sizeof(units[0]))-1)) {
+		value /= 1024.0;
+		ix++;
+	}
+
+	std::stringstream out;
+	out << std::fixed << std::setprecision(2) << value << " " << units[ix];
+	return out.str();
+
+ }
+
+ class UsageAgent::Directory : public Udjat::Agent<unsigned long long> {
+ private:
+	/// @brief Agent name and label, released with the agent.
+	Udjat::Atom id;
+
+ public:
+	Directory(const Udjat::Atom &name) : Udjat::Agent<unsigned long long>(name.c_str()), id(name) {
+		Object::properties.label = id.c_str();
+		Object::properties.icon = "folder";
+	}
+
+	std::string to_string() const noexcept override {
+		return format(get());
+	}
+
+ };
+
+ struct UsageAgent::Scan {
+
+	/// @brief Protects the owner.
+	std::mutex guard;
+
+	/// @brief The agent to publish to, nullptr after it was destroyed.
+	UsageAgent *owner;
+
+	/// @brief Is a scan running?
+	std::atomic<bool> running{false};
+
+	/// @brief Scanner, used only by the running scan.
+	Udjat::DiskUsage scanner;
+
+	Scan(UsageAgent *o, unsigned int threads) : owner(o), scanner(threads) {
+	}
+
+ };
+
+ UsageAgent::UsageAgent(const char *p, const char *name, const pugi::xml_node &node)
+	: Udjat::Abstract::Agent(name), path(p), scan(make_shared<Scan>(this,node.attribute("threads").as_uint(0))) {
+
+	Object::properties.icon = "folder";
+	Object::properties.label = path;
+
+	rescan = node.attribute("full-scan").as_uint(rescan);
+	update.timer = (unsigned short) node.attribute("update-timer").as_uint(600);
+
+ }
+
+ UsageAgent::~UsageAgent() {
+	std::lock_guard<std::mutex> lock(scan->guard);
+	scan->owner = nullptr;
+ }
+
+ bool UsageAgent::refresh() {
+
+	if(scan->running.exchange(true)) {
+		info() << path << ": previous scan still running" << endl;
+		return true;
+	}
+
+	bool full = false;
+	if(rescan && ++scans >= rescan) {
+		full = true;
+		scans = 0;
+	}
+
+	// A scan can take minutes on large trees, keep it off the refresh thread.
+	std::thread([](std::shared_ptr<Scan> scan, std::string path, bool full){
+
+		std::vector<Udjat::DiskUsage::Entry> entries;
+		std::string failure;
+
+		try {
+
+			if(full) {
+				scan->scanner.invalidate();
+			}
+			scan->scanner.scan(path.c_str(),entries);
+
+		} catch(const std::exception &e) {
+
+			failure = e.what();
+
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(scan->guard);
+
+			UsageAgent *agent = scan->owner;
+			if(agent) {
+
+				if(failure.empty()) {
+
+					const Udjat::DiskUsage::Counters &counters = scan->scanner.stats();
+					agent->info()	<< path << ": " << counters.directories << " directories ("
+									<< counters.listed << " changed) in "
+									<< std::fixed << std::setprecision(2) << counters.elapsed << "s"
+									<< endl;
+
+					agent->publish(entries);
+
+				} else {
+
+					agent->error() << "Can't scan " << path << ": " << failure << endl;
+
+				}
+
+			}
+		}
+
+		scan->running = false;
+
+	},scan,string{path},full).detach();
+
+	return true;
+
+ }
+
+ void UsageAgent::publish(const std::vector<Udjat::DiskUsage::Entry> &entries) {
+
+	// Retire agents for removed subdirectories.
+	for(auto directory = directories.begin(); directory != directories.end();) {
+
+		bool found = false;
+		for(const auto &entry : entries) {
+			if(entry.name == (*directory)->name()) {
+				found = true;
+				break;
+			}
+		}
+
+		if(found) {
+			directory++;
+		} else {
+			Udjat::Abstract::Agent::remove(*directory);
+			directory = directories.erase(directory);
+		}
+
+	}
+
+	// Update (or create) the subdirectory agents.
+	uint64_t bytes = 0;
+	for(const auto &entry : entries) {
+
+		bytes += entry.bytes;
+
+		std::shared_ptr<Directory> agent;
+		for(auto directory : directories) {
+			if(entry.name == directory->name()) {
+				agent = directory;
+				break;
+			}
+		}
+
+		if(!agent) {
+			agent = make_shared<Directory>(Udjat::Atom{entry.name});
+			directories.push_back(agent);
+			Udjat::Abstract::Agent::push_back(agent);
+		}
+
+		agent->set(entry.bytes);
+
+	}
+
+	total = bytes;
+
+ }
+
+ std::string UsageAgent::to_string() const noexcept {
+	return format(total);
+ }
+
@@ -0,0 +1,472 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2021 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ #include <config.h>
+ #include <writeback.h>
+ #include <udjat/iostat.h>
+ #include <udjat/tools/intl.h>
+ #include <udjat/tools/logger.h>
+ #include <system_error>
+ #include <functional>
+ #include <sstream>
+ #include <iomanip>
+ #include <limits>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <cstring>
+ #include <ctime>
+ #include <dirent.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/sysmacros.h>
+
+ using namespace std;
+
+ /// @brief Read a small /proc or /sys file.
+ /// @return false if the file can't be read.
+ static bool load(const char *filename, char *text, size_t length) {
+
+	int fd = open(filename,O_RDONLY|O_CLOEXEC);
+	if(fd < 0) {
+		return false;
+	}
+
+	ssize_t bytes = read(fd,text,length-1);
+	::close(fd);
+
+	if(bytes < 0) {
+		return false;
+	}
+
+	text[bytes] = 0;
+	return true;
+
+ }
+
+ /// @brief Parse 'Key:   value kB' lines (meminfo and bdi stats).
+ /// @param call Callback for each line, with the value in bytes for 'kB' and 'kBps' units.
+ static void parse(const char *text, const std::function<void(const char *key, size_t length, uint64_t value)> &call) {
+
+	const char *ptr = text;
+
+	while(*ptr) {
+
+		const char *eol = strchr(ptr,'\n');
+		if(!eol) {
+			eol = ptr + strlen(ptr);
+		}
+
+		const char *colon = (const char *) memchr(ptr,':',eol-ptr);
+		if(colon) {
+			char *end;
+			uint64_t value = strtoull(colon+1,&end,10);
+			while(*end == ' ') {
+				end++;
+			}
+			if(*end == 'k') {
+				value *= 1024;
+			}
+			call(ptr,colon-ptr,value);
+		}
+
+		ptr = (*eol ? eol+1 : eol);
+
+	}
+
+ }
+
+ static inline bool match(const char *key, size_t length, const char *name) noexcept {
+	return strlen(name) == length && !strncmp(key,name,length);
+ }
+
+ /// @brief Get a dirty threshold; vm.dirty_[background_]bytes overrides the ratio.
+ /// @param bytes The 'bytes' sysctl.
+ /// @param ratio The 'ratio' sysctl.
+ /// @param dirtyable Memory available for the page cache.
+ static uint64_t limit(const char *bytes, const char *ratio, uint64_t dirtyable) {
+
+	char text[32];
+	string filename{"/proc/sys/vm/"};
+
+	if(load((filename + bytes).c_str(),text,sizeof(text))) {
+		uint64_t value = strtoull(text,nullptr,10);
+		if(value) {
+			return value;
+		}
+	}
+
+	if(load((filename + ratio).c_str(),text,sizeof(text))) {
+		return (dirtyable * strtoull(text,nullptr,10)) / 100;
+	}
+
+	return 0;
+
+ }
+
+ /// @brief Find the per-bdi stats: sysfs on some kernels, debugfs on most.
+ static string locate() {
+
+	for(const char *path : { "/sys/class/bdi", "/sys/kernel/debug/bdi" }) {
+
+		DIR *dir = opendir(path);
+		if(!dir) {
+			continue;
+		}
+
+		bool found = false;
+		while(struct dirent *entry = readdir(dir)) {
+			if(entry->d_name[0] != '.') {
+				found = (access((string{path} + "/" + entry->d_name + "/stats").c_str(),R_OK) == 0);
+				break;
+			}
+		}
+		closedir(dir);
+
+		if(found) {
+			return path;
+		}
+
+	}
+
+	return string{};
+
+ }
+
+ double WritebackAgent::Backlog::drain(float bandwidth) const noexcept {
+
+	uint64_t pending = dirty + writeback;
+	if(!pending) {
+		return 0;
+	}
+
+	float speed = (rate > 0 ? rate : bandwidth);
+	if(speed <= 0) {
+		return -1;
+	}
+
+	return ((double) pending) / speed;
+
+ }
+
+ WritebackAgent::WritebackAgent(const char *name, const pugi::xml_node &node) : super(name), bdi(locate()) {
+
+	Object::properties.icon = "drive-harddisk";
+	Object::properties.label = _( "Dirty pages" );
+
+	update.timer = (unsigned short) node.attribute("writeback-timer").as_uint(5);
+
+	if(bdi.empty()) {
+		warning() << "Per device writeback stats are not available (is debugfs mounted?), reporting system wide values only" << endl;
+	}
+
+ }
+
+ WritebackAgent::~WritebackAgent() {
+ }
+
+ void WritebackAgent::start() {
+
+	if(states.empty()) {
+
+		// Place the states on the kernel thresholds; with ratios (the default)
+		// their relative positions don't depend on the memory size.
+		try {
+			std::lock_guard<std::mutex> lock(guard);
+			global(0);
+			bdis(0);
+		} catch(const std::exception &e) {
+			warning() << e.what() << endl;
+		}
+
+		float bg = (threshold ? (float) ((((double) background) * 100) / threshold) : 50);
+
+		// Writers are not throttled below the middle of both thresholds (the 'freerun' ceiling).
+		float freerun = (bg + 100) / 2;
+
+		const struct {
+			float from;
+			float to;
+			const char 						* name;			///< @brief State name.
+			Udjat::Level					  level;		///< @brief State level.
+			const char						* summary;		///< @brief State summary.
+		} states[] = {
+			{
+				0.0,
+				bg,
+				"clean",
+				Udjat::ready,
+				N_( "Dirty pages are below the background writeback threshold" )
+			},
+			{
+				bg,
+				freerun,
+				"flushing",
+				Udjat::ready,
+				N_( "Background writeback in progress" )
+			},
+			{
+				freerun,
+				100.0,
+				"throttling",
+				Udjat::warning,
+				N_( "Too many dirty pages, writers are being throttled" )
+			},
+			{
+				100.0,
+				std::numeric_limits<float>::max(),
+				"blocked",
+				Udjat::error,
+				N_( "Dirty page limit reached, writers are blocked" )
+			}
+		};
+
+		info() << "Using default states (background writeback at " << std::fixed << std::setprecision(0) << bg << "%, throttling at " << freerun << "%)" << endl;
+
+		for(size_t ix = 0; ix < (sizeof(states)/ sizeof(states[0])); ix++) {
+
+			push_back(
+				make_shared<Udjat::State<float>>(
+					states[ix].name,
+					states[ix].from,
+					states[ix].to,
+					states[ix].level,
+#ifdef GETTEXT_PACKAGE
+					dgettext(GETTEXT_PACKAGE,states[ix].summary),
+#else
+					states[ix].summary,
+#endif // GETTEXT_PACKAGE
+					""
+				)
+			);
+
+		}
+
+	}
+
+	super::start();
+
+ }
+
+ void WritebackAgent::global(double elapsed) {
+
+	char text[8192];
+
+	if(!load("/proc/meminfo",text,sizeof(text))) {
+		throw system_error(errno,system_category(),"/proc/meminfo");
+	}
+
+	// Page cache candidates, as in global_dirtyable_memory() (without the reserves).
+	uint64_t dirtyable = 0;
+
+	parse(text,[this,&dirtyable](const char *key, size_t length, uint64_t value) {
+		if(match(key,length,"Dirty")) {
+			total.dirty = value;
+		} else if(match(key,length,"Writeback")) {
+			total.writeback = value;
+		} else if(match(key,length,"MemFree") || match(key,length,"Active(file)") || match(key,length,"Inactive(file)")) {
+			dirtyable += value;
+		}
+	});
+
+	threshold = limit("dirty_bytes","dirty_ratio",dirtyable);
+	background = limit("dirty_background_bytes","dirty_background_ratio",dirtyable);
+
+	// Pages written since boot.
+	char vmstat[16384];
+	if(load("/proc/vmstat",vmstat,sizeof(vmstat))) {
+
+		const char *ptr = strstr(vmstat,"\nnr_written ");
+		if(ptr) {
+			uint64_t written = strtoull(ptr+12,nullptr,10) * sysconf(_SC_PAGESIZE);
+			if(elapsed > 0 && written >= total.written) {
+				total.rate = (float) (((double) (written - total.written)) / elapsed);
+			}
+			total.written = written;
+		}
+
+	}
+
+ }
+
+ void WritebackAgent::bdis(double elapsed) {
+
+	if(bdi.empty()) {
+		return;
+	}
+
+	DIR *dir = opendir(bdi.c_str());
+	if(!dir) {
+		return;
+	}
+
+	std::vector<Device> current;
+
+	while(struct dirent *entry = readdir(dir)) {
+
+		unsigned int major, minor;
+		if(sscanf(entry->d_name,"%u:%u",&major,&minor) != 2) {
+			continue;
+		}
+
+		// Only the devices behind a mount point.
+		dev_t dev = makedev(major,minor);
+		if(mounts.find(dev) == mounts.end()) {
+			continue;
+		}
+
+		char text[4096];
+		if(!load((bdi + "/" + entry->d_name + "/stats").c_str(),text,sizeof(text))) {
+			continue;
+		}
+
+		Device device{dev};
+
+		parse(text,[this,&device](const char *key, size_t length, uint64_t value) {
+			if(match(key,length,"BdiReclaimable")) {
+				device.dirty = value;
+			} else if(match(key,length,"BdiWriteback")) {
+				device.writeback = value;
+			} else if(match(key,length,"BdiWritten")) {
+				device.written = value;
+			} else if(match(key,length,"BdiWriteBandwidth")) {
+				device.bandwidth = (float) value;
+			} else if(match(key,length,"DirtyThresh")) {
+				// The kernel's own thresholds, better than the meminfo estimate.
+				threshold = value;
+			} else if(match(key,length,"BackgroundThresh")) {
+				background = value;
+			}
+		});
+
+		for(const auto &previous : devices) {
+			if(previous.dev == dev) {
+				if(elapsed > 0 && device.written >= previous.written) {
+					device.rate = (float) (((double) (device.written - previous.written)) / elapsed);
+				}
+				break;
+			}
+		}
+
+		current.push_back(device);
+
+	}
+
+	closedir(dir);
+
+	devices = std::move(current);
+
+ }
+
+ bool WritebackAgent::refresh() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	double now = ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+
+	float value = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(guard);
+
+		double elapsed = (timestamp > 0 ? now - timestamp : 0);
+		timestamp = now;
+
+		global(elapsed);
+		bdis(elapsed);
+
+		if(threshold) {
+			value = (float) ((((double) (total.dirty + total.writeback)) * 100) / threshold);
+		}
+	}
+
+	super::set(value);
+	return true;
+
+ }
+
+ void WritebackAgent::set(const Udjat::MountInfo &mountinfo) {
+
+	std::unordered_map<dev_t,std::string> map;
+
+	for(const auto &entry : mountinfo) {
+
+		// Block devices write back through the whole disk, others (NFS, FUSE) through their own bdi.
+		std::string &mp = map[entry.device ? Udjat::IOStat::disk(entry.device) : entry.dev];
+		if(!mp.empty()) {
+			mp += ",";
+		}
+		mp += entry.mount_point;
+
+	}
+
+	std::lock_guard<std::mutex> lock(guard);
+	mounts = std::move(map);
+
+ }
+
+ void WritebackAgent::report(Udjat::Value &value) const {
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	float bandwidth = 0;
+	for(const auto &device : devices) {
+		bandwidth += device.bandwidth;
+	}
+
+	value["dirty"] = (unsigned long long) total.dirty;				// bytes
+	value["writeback"] = (unsigned long long) total.writeback;		// bytes
+	value["rate"] = total.rate;										// bytes/second
+	value["drain"] = total.drain(bandwidth);						// seconds, -1 if not draining
+	value["threshold"] = (unsigned long long) threshold;
+	value["background"] = (unsigned long long) background;
+
+	Udjat::Value &list = value["devices"];
+
+	for(const auto &device : devices) {
+
+		Udjat::Value &item = list.append(Udjat::Value::Object);
+
+		char dev[32];
+		snprintf(dev,sizeof(dev),"%u:%u",major(device.dev),minor(device.dev));
+
+		auto mp = mounts.find(device.dev);
+
+		item["dev"] = dev;
+		item["mp"] = (mp == mounts.end() ? "" : mp->second.c_str());
+		item["dirty"] = (unsigned long long) device.dirty;
+		item["writeback"] = (unsigned long long) device.writeback;
+		item["rate"] = device.rate;
+		item["bandwidth"] = device.bandwidth;
+		item["drain"] = device.drain(device.bandwidth);
+
+	}
+
+ }
+
+ void WritebackAgent::get(const Udjat::Request &request, Udjat::Response &response) {
+	super::get(request,response);
+	report(response);
+ }
+
+ std::string WritebackAgent::to_string() const noexcept {
+	std::stringstream out;
+	out << std::fixed << std::setprecision(2) << super::get() << "%";
+	return out.str();
+ }